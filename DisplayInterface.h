@@ -20,6 +20,8 @@
 #ifndef DRIVERS_DISPLAYINTERFACE_H_
 #define DRIVERS_DISPLAYINTERFACE_H_
 
+#include "DisplayStats.h"
+
 class DisplayInterface
 {
 
@@ -42,6 +44,21 @@ public:
 	 */
 	virtual void write(const uint8_t* buffer, uint32_t num_cmd_bytes, uint32_t buf_len) = 0;
 
+	/**
+	 * Writes rows of data spaced by a stride (eg: a sub-rectangle of a framebuffer)
+	 * without copying them into a contiguous buffer first
+	 * @note The default implementation writes each row as a separate transaction
+	 * @param[in] base pointer to the first byte of the first row
+	 * @param[in] stride Distance in bytes between the start of two rows
+	 * @param[in] row_bytes Number of bytes to write from each row
+	 * @param[in] rows Number of rows
+	 */
+	virtual void write_strided(const uint8_t* base, uint32_t stride, uint32_t row_bytes, uint32_t rows) {
+		for(uint32_t i = 0; i < rows; i++) {
+			write(base + (i * stride), 0, row_bytes);
+		}
+	}
+
 	/**
 	 * Reads a buffer from the display interface
 	 * @note: May not be available
@@ -51,6 +68,26 @@ public:
 	 */
 	virtual uint8_t read(uint8_t* buffer, uint32_t size) = 0;
 
+	/**
+	 * Gets a snapshot of the interface's performance counters
+	 * @param[out] stats Snapshot to fill
+	 */
+	void get_stats(display_stats_t& stats) {
+		_stats.snapshot(stats);
+	}
+
+	/**
+	 * Resets the interface's performance counters
+	 */
+	void reset_stats(void) {
+		_stats.reset();
+	}
+
+protected:
+
+	/** Performance counters, updated by implementations */
+	DisplayStats _stats;
+
 };
 
 #endif /* DRIVERS_DISPLAYINTERFACE_H_ */
@@ -0,0 +1,157 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "NoritakeResponseParser.h"
+
+NoritakeResponseParser::NoritakeResponseParser(void) : _state(STATE_IDENTIFIER),
+		_count(0), _expected(0), _discarded(0) {
+}
+
+void NoritakeResponseParser::feed(const uint8_t* data, uint32_t length) {
+	while(length--) {
+		step(*data++);
+	}
+}
+
+void NoritakeResponseParser::reset(void) {
+	_state = STATE_IDENTIFIER;
+	_count = 0;
+}
+
+void NoritakeResponseParser::step(uint8_t byte) {
+	switch(_state) {
+	case STATE_IDENTIFIER:
+		_count = 0;
+		switch(byte) {
+		case NORITAKE_RESPONSE_TOUCH_STATUS_ALL:
+		case NORITAKE_RESPONSE_TOUCH_COUNT_LEVEL:
+		case NORITAKE_RESPONSE_TOUCH_LEVEL:
+			// Identifier, data length, data
+			_state = STATE_LENGTH;
+			break;
+		case NORITAKE_RESPONSE_TOUCH_STATUS:
+			// Identifier, switch number, ON/OFF
+			_expected = 3;
+			_state = STATE_DATA;
+			break;
+		case NORITAKE_RESPONSE_HEADER:
+			// Header, identifier 1, identifier 2, data
+			_state = STATE_GROUP;
+			break;
+		default:
+			_discarded++;
+			return;
+		}
+		_buffer[_count++] = byte;
+		break;
+
+	case STATE_LENGTH:
+		if(byte > NORITAKE_RESPONSE_MAX_DATA) {
+			// The byte may start the next response
+			discard();
+			step(byte);
+			return;
+		}
+		_buffer[_count++] = byte;
+		if(byte == 0) {
+			complete();
+		} else {
+			_expected = 2 + byte;
+			_state = STATE_DATA;
+		}
+		break;
+
+	case STATE_GROUP:
+		if(byte != 0x70 && byte != 0x65) {
+			discard();
+			step(byte);
+			return;
+		}
+		_buffer[_count++] = byte;
+		_state = STATE_FUNCTION;
+		break;
+
+	case STATE_FUNCTION:
+		// I/O port input, Memory SW data send, User setup mode start
+		if(!((_buffer[1] == 0x70 && byte == 0x20) ||
+				(_buffer[1] == 0x65 && (byte == 0x04 || byte == 0x01)))) {
+			discard();
+			step(byte);
+			return;
+		}
+		_buffer[_count++] = byte;
+		_expected = 4;
+		_state = STATE_DATA;
+		break;
+
+	case STATE_DATA:
+		_buffer[_count++] = byte;
+		if(_count == _expected) {
+			complete();
+		}
+		break;
+	}
+}
+
+void NoritakeResponseParser::complete(void) {
+	_state = STATE_IDENTIFIER;
+
+	switch(_buffer[0]) {
+	case NORITAKE_RESPONSE_TOUCH_STATUS_ALL:
+		if(_touch_status) {
+			// Sent starting from the highest switch numbers
+			uint32_t switches = 0;
+			for(uint32_t i = 2; i < _count; i++) {
+				switches = (switches << 8) | _buffer[i];
+			}
+			_touch_status(switches);
+		}
+		break;
+	case NORITAKE_RESPONSE_TOUCH_STATUS:
+		if(_touch_switch) {
+			_touch_switch(_buffer[1], (_buffer[2] != 0));
+		}
+		break;
+	case NORITAKE_RESPONSE_TOUCH_COUNT_LEVEL:
+	case NORITAKE_RESPONSE_TOUCH_LEVEL:
+		if(_touch_levels) {
+			// Sent starting from the highest switch number
+			uint8_t levels[NORITAKE_RESPONSE_MAX_DATA];
+			uint8_t count = _buffer[1];
+			for(uint32_t i = 0; i < count; i++) {
+				levels[i] = _buffer[_count - 1 - i];
+			}
+			_touch_levels(_buffer[0], levels, count);
+		}
+		break;
+	case NORITAKE_RESPONSE_HEADER:
+		if(_io_input && _buffer[1] == 0x70) {
+			_io_input(_buffer[3]);
+		}
+		break;
+	}
+
+	if(_response) {
+		_response(_buffer, _count);
+	}
+}
+
+void NoritakeResponseParser::discard(void) {
+	_discarded += _count;
+	_state = STATE_IDENTIFIER;
+	_count = 0;
+}
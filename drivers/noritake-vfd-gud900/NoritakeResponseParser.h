@@ -0,0 +1,155 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UDISPLAY_DRIVERS_NORITAKE_VFD_GUD900_NORITAKERESPONSEPARSER_H_
+#define UDISPLAY_DRIVERS_NORITAKE_VFD_GUD900_NORITAKERESPONSEPARSER_H_
+
+#include <stdint.h>
+
+#include "platform/Callback.h"
+
+/** Response identifiers */
+#define NORITAKE_RESPONSE_TOUCH_STATUS_ALL	0x10
+#define NORITAKE_RESPONSE_TOUCH_STATUS		0x11
+#define NORITAKE_RESPONSE_TOUCH_COUNT_LEVEL	0x14
+#define NORITAKE_RESPONSE_TOUCH_LEVEL		0x15
+#define NORITAKE_RESPONSE_HEADER			0x28
+
+/** Largest information data length of a response (one byte per touch switch) */
+#ifndef NORITAKE_RESPONSE_MAX_DATA
+#define NORITAKE_RESPONSE_MAX_DATA			32
+#endif
+
+/**
+ * Decodes the byte stream transmitted by a Noritake GU-D module
+ *
+ * Touch switch and I/O port replies (requested, or sent automatically by
+ * the touch switch transmit modes) are delivered through callbacks as they
+ * complete. Bytes that don't start a known response are discarded, so the
+ * parser resynchronizes on the next response.
+ *
+ * This class has no hardware dependencies so it can be tested on a host.
+ */
+class NoritakeResponseParser
+{
+	public:
+
+		/** Status of all touch switches, bit 0 is SW1 */
+		typedef mbed::Callback<void(uint32_t)> touch_status_handler_t;
+
+		/** Status of a single touch switch (0 is SW1) */
+		typedef mbed::Callback<void(uint8_t, bool)> touch_switch_handler_t;
+
+		/**
+		 * Count or touch levels of all switches (identifier, levels with SW1
+		 * first, number of switches)
+		 */
+		typedef mbed::Callback<void(uint8_t, const uint8_t*, uint8_t)> touch_levels_handler_t;
+
+		/** State of the general-purpose I/O port */
+		typedef mbed::Callback<void(uint8_t)> io_input_handler_t;
+
+		/** Any complete response, as received */
+		typedef mbed::Callback<void(const uint8_t*, uint32_t)> response_handler_t;
+
+		NoritakeResponseParser(void);
+
+		virtual ~NoritakeResponseParser(void) { }
+
+		void attach_touch_status(touch_status_handler_t handler) {
+			_touch_status = handler;
+		}
+
+		void attach_touch_switch(touch_switch_handler_t handler) {
+			_touch_switch = handler;
+		}
+
+		void attach_touch_levels(touch_levels_handler_t handler) {
+			_touch_levels = handler;
+		}
+
+		void attach_io_input(io_input_handler_t handler) {
+			_io_input = handler;
+		}
+
+		void attach_response(response_handler_t handler) {
+			_response = handler;
+		}
+
+		/**
+		 * Parses received bytes, calling handlers for completed responses
+		 * @param[in] data Received bytes
+		 * @param[in] length Number of bytes
+		 */
+		void feed(const uint8_t* data, uint32_t length);
+
+		/**
+		 * Drops any partially received response
+		 */
+		void reset(void);
+
+		/**
+		 * Gets the number of bytes discarded while looking for a response
+		 */
+		uint32_t discarded(void) const {
+			return _discarded;
+		}
+
+	private:
+
+		typedef enum {
+			STATE_IDENTIFIER,
+			STATE_LENGTH,
+			STATE_GROUP,
+			STATE_FUNCTION,
+			STATE_DATA
+		} state_t;
+
+		/** Parses a single byte */
+		void step(uint8_t byte);
+
+		/** Delivers the response in the buffer */
+		void complete(void);
+
+		/** Drops the response in the buffer */
+		void discard(void);
+
+		state_t _state;
+
+		/** Response being received, starting with its identifier */
+		uint8_t _buffer[NORITAKE_RESPONSE_MAX_DATA + 3];
+
+		uint32_t _count;
+
+		/** Total length of the response being received */
+		uint32_t _expected;
+
+		uint32_t _discarded;
+
+		touch_status_handler_t _touch_status;
+
+		touch_switch_handler_t _touch_switch;
+
+		touch_levels_handler_t _touch_levels;
+
+		io_input_handler_t _io_input;
+
+		response_handler_t _response;
+
+};
+
+#endif /* UDISPLAY_DRIVERS_NORITAKE_VFD_GUD900_NORITAKERESPONSEPARSER_H_ */
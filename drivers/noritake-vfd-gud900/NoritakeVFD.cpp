@@ -16,13 +16,16 @@
  */
 
 #include "NoritakeVFD.h"
+#include "UARTInterface.h"
 
 #include "rtos/ThisThread.h"
+#include "platform/mbed_critical.h"
+#include "platform/mbed_shared_queues.h"
 
 NoritakeVFD::NoritakeVFD(DisplayInterface& interface,
 		PinName reset, uint32_t height, uint32_t width) :
 		DisplayDriver(interface), _height(height), _width(width), _lines(
-				height / 8) {
+				height / 8), _uart(NULL), _touch_ready(NULL), _process_posted(0), _process_running(0), _closing(false) {
 	if(reset != NC) {
 		_reset = new mbed::DigitalOut(reset, 1);
 	}
@@ -31,7 +34,49 @@ NoritakeVFD::NoritakeVFD(DisplayInterface& interface,
 	}
 }
 
+#if (DEVICE_SERIAL && DEVICE_INTERRUPTIN)
+
+NoritakeVFD::NoritakeVFD(UARTInterface& uart,
+		PinName reset, uint32_t height, uint32_t width) :
+		DisplayDriver(uart), _height(height), _width(width), _lines(
+				height / 8), _uart(&uart), _touch_ready(NULL), _process_posted(0), _process_running(0), _closing(false) {
+	if(reset != NC) {
+		_reset = new mbed::DigitalOut(reset, 1);
+	}
+	else {
+		_reset = NULL;
+	}
+}
+
+#endif
+
 NoritakeVFD::~NoritakeVFD(void) {
+	// Stop the interrupts that schedule process_responses() and keep it from rescheduling itself
+	if(_touch_ready != NULL) {
+		_touch_ready->fall(NULL);
+	}
+#if (DEVICE_SERIAL && DEVICE_INTERRUPTIN)
+	if(_uart != NULL) {
+		_uart->attach_rx(NULL);
+	}
+#endif
+	_closing = true;
+
+	// Once _process_posted is taken no event is pending and posting fails
+	uint32_t expected = 0;
+	while(!core_util_atomic_cas_u32(&_process_posted, &expected, 1)) {
+		expected = 0;
+		rtos::ThisThread::sleep_for(NORITAKE_VFD_PROCESS_RETRY_MS);
+	}
+	// Wait for a running process_responses() to finish with _touch_ready and _read_mutex
+	while(_process_running) {
+		rtos::ThisThread::sleep_for(NORITAKE_VFD_PROCESS_RETRY_MS);
+	}
+
+	if(_touch_ready != NULL) {
+		delete _touch_ready;
+		_touch_ready = NULL;
+	}
 	if(_reset != NULL) {
 		delete _reset;
 		_reset = NULL;
@@ -513,12 +558,8 @@ void NoritakeVFD::draw_FROM_image(unsigned x, unsigned y, uint8_t memory,
 }
 
 void NoritakeVFD::enter_user_setup_mode() {
-	_interface.write(0x1f);
-	_interface.write(0x28);
-	_interface.write(0x65);
-	_interface.write(0x01);
-	_interface.write(0x49);
-	_interface.write(0x4e);
+	const uint8_t command[] = { 0x1f, 0x28, 0x65, 0x01, 0x49, 0x4e };
+	_interface.write(command, sizeof(command), sizeof(command));
 }
 
 void NoritakeVFD::end_user_setup_mode() {
@@ -531,6 +572,242 @@ void NoritakeVFD::end_user_setup_mode() {
 	_interface.write(0x54);
 }
 
+void NoritakeVFD::memory_sw_write(uint8_t sw, uint8_t value) {
+	_interface.write(0x1f);
+	_interface.write(0x28);
+	_interface.write(0x65);
+	_interface.write(0x03);
+	_interface.write(sw);
+	_interface.write(value);
+}
+
+#if (DEVICE_SERIAL && DEVICE_INTERRUPTIN)
+
+/** Memory SW 48 codes, highest baud rate first */
+static const struct {
+	int baud;
+	uint8_t code;
+} noritake_baud_rates[] = {
+	{ 115200, 0x06 },
+	{ 57600, 0x05 },
+	{ 38400, 0x04 },
+	{ 19200, 0x03 },
+	{ 9600, 0x02 },
+	{ 4800, 0x01 }
+};
+
+#define NORITAKE_NUM_BAUD_RATES (sizeof(noritake_baud_rates) / sizeof(noritake_baud_rates[0]))
+
+bool NoritakeVFD::memory_sw_read(uint8_t sw, uint8_t& value) {
+	if(_uart == NULL) {
+		return false;
+	}
+	if(!this->begin_user_setup()) {
+		return false;
+	}
+	bool ok = this->read_memory_sw(sw, value);
+	this->finish_user_setup();
+	return ok;
+}
+
+bool NoritakeVFD::set_baud(int baud) {
+	uint8_t code = 0;
+	if(_uart == NULL) {
+		return false;
+	}
+	for(unsigned i = 0; i < NORITAKE_NUM_BAUD_RATES; i++) {
+		if(noritake_baud_rates[i].baud == baud) {
+			code = noritake_baud_rates[i].code;
+		}
+	}
+	if(code == 0) {
+		return false;
+	}
+
+	// Make sure the module can be reached and keep its setting before changing it
+	int old_baud = _uart->get_baud();
+	uint8_t old_code, value;
+	if(!this->begin_user_setup()) {
+		return false;
+	}
+	bool ok = this->read_memory_sw(NORITAKE_VFD_MSW_BAUD_RATE, old_code);
+	if(ok) {
+		this->memory_sw_write(NORITAKE_VFD_MSW_BAUD_RATE, code);
+	}
+	this->finish_user_setup();
+	if(!ok) {
+		return false;
+	}
+
+	_uart->set_baud(baud);
+	_uart->flush_input();
+	if(this->memory_sw_read(NORITAKE_VFD_MSW_BAUD_RATE, value) && value == code) {
+		return true;
+	}
+
+	// Fall back: find the module again and restore its previous setting
+	_uart->set_baud(old_baud);
+	this->settle();
+	if(this->memory_sw_read(NORITAKE_VFD_MSW_BAUD_RATE, value) || this->find_baud()) {
+		this->write_baud_code(old_code);
+	}
+	_uart->set_baud(old_baud);
+	this->settle();
+	return false;
+}
+
+int NoritakeVFD::negotiate_baud(void) {
+	if(_uart == NULL) {
+		return 0;
+	}
+	for(unsigned i = 0; i < NORITAKE_NUM_BAUD_RATES; i++) {
+		if(noritake_baud_rates[i].baud <= _uart->get_baud()) {
+			break;
+		}
+		if(this->set_baud(noritake_baud_rates[i].baud)) {
+			break;
+		}
+	}
+	return _uart->get_baud();
+}
+
+bool NoritakeVFD::write_baud_code(uint8_t code) {
+	if(!this->begin_user_setup()) {
+		return false;
+	}
+	this->memory_sw_write(NORITAKE_VFD_MSW_BAUD_RATE, code);
+	this->finish_user_setup();
+	return true;
+}
+
+bool NoritakeVFD::begin_user_setup(void) {
+	uint8_t response[4];
+	_read_mutex.lock();
+	_uart->flush_input();
+	this->enter_user_setup_mode();
+
+	// Response: header 0x28, identifiers 0x65 0x01, NULL
+	uint32_t count = _uart->read_timeout(response, sizeof(response), NORITAKE_VFD_RESPONSE_TIMEOUT_MS);
+	if(count != sizeof(response) ||
+			response[0] != 0x28 || response[1] != 0x65 || response[2] != 0x01) {
+		// Ignored by the module if it isn't in user setup mode
+		this->end_user_setup_mode();
+		_read_mutex.unlock();
+		return false;
+	}
+	return true;
+}
+
+bool NoritakeVFD::read_memory_sw(uint8_t sw, uint8_t& value) {
+	uint8_t response[4];
+	const uint8_t command[] = { 0x1f, 0x28, 0x65, 0x04, sw };
+	_interface.write(command, sizeof(command), sizeof(command));
+
+	// Response: header 0x28, identifiers 0x65 0x04, data
+	uint32_t count = _uart->read_timeout(response, sizeof(response), NORITAKE_VFD_RESPONSE_TIMEOUT_MS);
+	if(count != sizeof(response) ||
+			response[0] != 0x28 || response[1] != 0x65 || response[2] != 0x04) {
+		return false;
+	}
+	value = response[3];
+	return true;
+}
+
+void NoritakeVFD::finish_user_setup(void) {
+	// The module reloads its Memory SW settings with a software reset
+	this->end_user_setup_mode();
+	_uart->sync();
+	_read_mutex.unlock();
+	this->settle();
+}
+
+bool NoritakeVFD::find_baud(void) {
+	uint8_t value;
+	for(unsigned i = 0; i < NORITAKE_NUM_BAUD_RATES; i++) {
+		_uart->set_baud(noritake_baud_rates[i].baud);
+		this->settle();
+		if(this->memory_sw_read(NORITAKE_VFD_MSW_BAUD_RATE, value)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void NoritakeVFD::settle(void) {
+	rtos::ThisThread::sleep_for(NORITAKE_VFD_SOFT_RESET_MS);
+	_uart->flush_input();
+}
+
+bool NoritakeVFD::attach_rx_events(void) {
+	if(_uart == NULL) {
+		return false;
+	}
+	_uart->attach_rx(mbed::callback(this, &NoritakeVFD::response_event));
+	return true;
+}
+
+#endif
+
+void NoritakeVFD::attach_touch_handler(mbed::Callback<void(uint32_t)> handler, PinName touch_ready) {
+	_responses.attach_touch_status(handler);
+	if(touch_ready != NC && _touch_ready == NULL) {
+		// /TRDY goes low when the module has data to transmit
+		_touch_ready = new mbed::InterruptIn(touch_ready);
+		_touch_ready->fall(mbed::callback(this, &NoritakeVFD::response_event));
+		if(_touch_ready->read() == 0) {
+			this->post_process_responses();
+		}
+	}
+}
+
+void NoritakeVFD::process_responses(void) {
+	uint8_t data[16];
+	uint8_t count;
+
+	// Mark it running before it can be posted again, the destructor waits on it
+	core_util_atomic_store_u32(&_process_running, 1);
+	core_util_atomic_store_u32(&_process_posted, 0);
+	if(!_read_mutex.trylock()) {
+		// A response is being read synchronously, don't block the shared event queue
+		this->post_process_responses(NORITAKE_VFD_PROCESS_RETRY_MS);
+		core_util_atomic_store_u32(&_process_running, 0);
+		return;
+	}
+	while((count = _interface.read(data, sizeof(data))) > 0) {
+		_responses.feed(data, count);
+	}
+	_read_mutex.unlock();
+
+	// /TRDY is level signalled, more data may have arrived meanwhile
+	if(_touch_ready != NULL && _touch_ready->read() == 0) {
+		this->post_process_responses(1);
+	}
+	core_util_atomic_store_u32(&_process_running, 0);
+}
+
+void NoritakeVFD::response_event(void) {
+	this->post_process_responses();
+}
+
+void NoritakeVFD::post_process_responses(int delay_ms) {
+	if(_closing) {
+		return;
+	}
+	uint32_t expected = 0;
+	if(!core_util_atomic_cas_u32(&_process_posted, &expected, 1)) {
+		return;
+	}
+	int id;
+	if(delay_ms) {
+		id = mbed::mbed_event_queue()->call_in(delay_ms, this, &NoritakeVFD::process_responses);
+	} else {
+		id = mbed::mbed_event_queue()->call(this, &NoritakeVFD::process_responses);
+	}
+	if(id == 0) {
+		core_util_atomic_store_u32(&_process_posted, 0);
+	}
+}
+
 void NoritakeVFD::touch_status_read_all() {
 	_interface.write(0x1f);
 	_interface.write(0x4b);
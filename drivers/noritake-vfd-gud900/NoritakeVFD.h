@@ -19,9 +19,35 @@
 #define UDISPLAY_DRIVERS_NORITAKE_VFD_GUD900_NORITAKEVFD_H_
 
 #include "DisplayDriver.h"
+#include "NoritakeResponseParser.h"
 
 #include "drivers/InterruptIn.h"
 #include "drivers/DigitalOut.h"
+#include "rtos/Mutex.h"
+
+/**
+ * Memory SW holding the asynchronous serial baud rate.
+ * The module only uses it when jumpers J0 and J1 are both shorted,
+ * otherwise the jumpers select 9600, 19200 or 38400bps
+ */
+#define NORITAKE_VFD_MSW_BAUD_RATE			48
+
+/** Maximum time to wait for a module response */
+#ifndef NORITAKE_VFD_RESPONSE_TIMEOUT_MS
+#define NORITAKE_VFD_RESPONSE_TIMEOUT_MS	100
+#endif
+
+/** Time the module takes to software reset when user setup mode ends */
+#ifndef NORITAKE_VFD_SOFT_RESET_MS
+#define NORITAKE_VFD_SOFT_RESET_MS			200
+#endif
+
+/** Delay before process_responses() retries while a response is read synchronously */
+#ifndef NORITAKE_VFD_PROCESS_RETRY_MS
+#define NORITAKE_VFD_PROCESS_RETRY_MS		1
+#endif
+
+class UARTInterface;
 
 class NoritakeVFD : public DisplayDriver
 {
@@ -37,9 +63,69 @@ class NoritakeVFD : public DisplayDriver
 		NoritakeVFD(DisplayInterface& interface,
 				PinName reset = NC, uint32_t height = 32, uint32_t width = 128);
 
+#if (DEVICE_SERIAL && DEVICE_INTERRUPTIN) || defined(DOXYGEN_ONLY)
+
+		/**
+		 * Instantiates a DisplayDriver on a UART, enabling the functions that
+		 * read module responses synchronously or change the baud rate
+		 * @parameter[in] uart UART interface to use to communicate with VFD module
+		 * @parameter[in] reset (optional) Reset pin to display
+		 * @parameter[in] height (optional) Height in pixels of the VFD display
+		 * @paramter[in] width (optional) Width in pixels of the VFD display
+		 */
+		NoritakeVFD(UARTInterface& uart,
+				PinName reset = NC, uint32_t height = 32, uint32_t width = 128);
+
+#endif
+
+		/**
+		 * Waits for any scheduled response processing to finish
+		 * @note Must not be called from the shared event queue
+		 */
 		virtual ~NoritakeVFD();
 
-		//void attach_touch_handler(PinName touch_ready, void function pointer);
+		/**
+		Attaches a handler for the status of all touch switches.
+
+		Called (on the shared event queue) with bit 0 set if SW1 is ON, bit 1
+		for SW2, etc, when a status read reply or an automatic status
+		transmission (see touch_set()) is received.
+
+		@param  handler      Touch status handler
+		@param  touch_ready  (optional) /TRDY output of the module. Responses
+		                     are read as soon as the module has data to transmit
+		@return none
+		*/
+		void attach_touch_handler(mbed::Callback<void(uint32_t)> handler, PinName touch_ready = NC);
+
+#if (DEVICE_SERIAL && DEVICE_INTERRUPTIN) || defined(DOXYGEN_ONLY)
+
+		/**
+		Reads responses as the UART receives them (when /TRDY isn't connected).
+
+		@return false if the display wasn't instantiated on a UART
+		*/
+		bool attach_rx_events(void);
+
+#endif
+
+		/**
+		Gets the response parser, to attach handlers for other responses
+		(individual switch status, touch levels, I/O port input...).
+
+		@return the response parser
+		*/
+		NoritakeResponseParser& responses(void) {
+			return _responses;
+		}
+
+		/**
+		Reads every byte the module has transmitted and parses it.
+		Called automatically when /TRDY or UART RX events are used.
+
+		@return none
+		*/
+		void process_responses(void);
 
 		/**
 		Initializes the Noritake GUD series module.
@@ -613,6 +699,58 @@ class NoritakeVFD : public DisplayDriver
 		*/
 		void end_user_setup_mode();
 
+		/**
+		Sets a Memory SW (non volatile setting).
+		This command is only valid in user setup mode.
+
+		@param  sw     Memory SW number (0-63)
+		@param  value  Setting data
+		@return none
+		*/
+		void memory_sw_write(uint8_t sw, uint8_t value);
+
+#if (DEVICE_SERIAL && DEVICE_INTERRUPTIN) || defined(DOXYGEN_ONLY)
+
+		/**
+		Reads a Memory SW.
+
+		The Memory SW data send command is only valid in user setup mode, so
+		the module enters it for the read and software resets when it ends.
+		The reset clears the display settings, call init() afterwards.
+
+		@param  sw     Memory SW number (0-63)
+		@param  value  Setting data read from the module
+		@return true if the module responded (false if the display wasn't
+		        instantiated on a UART)
+		*/
+		bool memory_sw_read(uint8_t sw, uint8_t& value);
+
+		/**
+		Switches the module and the UART to another baud rate.
+
+		The current setting is read and the new rate stored in Memory SW 48 in
+		one user setup mode session, the module software resets and the rate
+		is verified by reading Memory SW 48 back at the new rate.
+		On failure, the previous rate and setting are restored.
+
+		@note The module only follows Memory SW 48 when jumpers J0 and J1 are shorted.
+		The software reset clears the display settings, call init() afterwards.
+
+		@param  baud   New baud rate (4800, 9600, 19200, 38400, 57600 or 115200)
+		@return true if the module now communicates at the new baud rate
+		*/
+		bool set_baud(int baud);
+
+		/**
+		Switches the module and the UART to the highest baud rate that works.
+
+		@return the baud rate in use afterwards (0 if the display wasn't
+		        instantiated on a UART)
+		*/
+		int negotiate_baud(void);
+
+#endif
+
 		/**
 		Function to show the ON/OFF status for all touch switches.
 
@@ -743,12 +881,64 @@ class NoritakeVFD : public DisplayDriver
 
 	protected:
 
+#if (DEVICE_SERIAL && DEVICE_INTERRUPTIN) || defined(DOXYGEN_ONLY)
+
+		/** Writes a baud rate code to Memory SW 48 and lets the module reset */
+		bool write_baud_code(uint8_t code);
+
+		/**
+		 * Enters user setup mode and waits for the module to confirm it
+		 * @note Holds the response read mutex until finish_user_setup() on success
+		 */
+		bool begin_user_setup(void);
+
+		/** Reads a Memory SW, only valid between begin_user_setup() and finish_user_setup() */
+		bool read_memory_sw(uint8_t sw, uint8_t& value);
+
+		/** Ends user setup mode and waits for the module software reset */
+		void finish_user_setup(void);
+
+		/** Looks for the module at every supported baud rate */
+		bool find_baud(void);
+
+		/** Waits for the module to reset and discards anything received meanwhile */
+		void settle(void);
+
+#endif
+
+		/** Schedules process_responses() on the shared event queue, unless already scheduled */
+		void post_process_responses(int delay_ms = 0);
+
+		/** Data to read signal (/TRDY or UART RX, interrupt context) */
+		void response_event(void);
+
 		/** The height and width of the display (in pixels) and the number of lines */
 		uint32_t _height, _width, _lines;
 
 		/** Reset pin */
 		mbed::DigitalOut* _reset;
 
+		/** UART the display is connected to, NULL for other interfaces */
+		UARTInterface* _uart;
+
+		/** Response parser */
+		NoritakeResponseParser _responses;
+
+		/** Touch ready (/TRDY) input (optional) */
+		mbed::InterruptIn* _touch_ready;
+
+		/** Serializes response reads */
+		rtos::Mutex _read_mutex;
+
+		/** Set while process_responses() is scheduled */
+		volatile uint32_t _process_posted;
+
+		/** Set while process_responses() runs */
+		volatile uint32_t _process_running;
+
+		/** Set once destruction has started, process_responses() is no longer scheduled */
+		volatile bool _closing;
+
 
 };
 
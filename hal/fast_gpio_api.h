@@ -0,0 +1,54 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UDISPLAY_HAL_FAST_GPIO_API_H_
+#define UDISPLAY_HAL_FAST_GPIO_API_H_
+
+/**
+ * Fast GPIO output HAL
+ *
+ * Toggling a pin through mbed::DigitalOut goes through the HAL gpio_write()
+ * call. Fast GPIO caches the port's set/clear register addresses and the
+ * pin mask when the pin is initialized, so each edge is a single store.
+ *
+ * A target supports fast GPIO by providing a "fast_gpio_device.h" header
+ * (in its targets/TARGET_xxx directory) which defines:
+ *
+ * - fast_gpio_t: the pin object
+ * - void fast_gpio_init(fast_gpio_t* obj, PinName pin, int value):
+ *   configures the pin as an output with an initial value. Must accept NC,
+ *   in which case writes to the object have no effect
+ * - void fast_gpio_set(fast_gpio_t* obj): drives the pin high
+ * - void fast_gpio_clear(fast_gpio_t* obj): drives the pin low
+ * - void fast_gpio_write(fast_gpio_t* obj, int value)
+ *
+ * These are expected to be static inline functions, so they compile down
+ * to a store at the call site.
+ *
+ * UDISPLAY_FAST_GPIO is defined when the target supports fast GPIO
+ * (DEVICE_ names are left to Mbed OS target capabilities).
+ * Otherwise, users fall back to mbed::DigitalOut (see FastDigitalOut).
+ */
+
+#if defined(__has_include)
+#if __has_include("fast_gpio_device.h")
+#include "fast_gpio_device.h"
+#define UDISPLAY_FAST_GPIO 1
+#endif
+#endif
+
+#endif /* UDISPLAY_HAL_FAST_GPIO_API_H_ */
@@ -0,0 +1,294 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UDISPLAY_INTERFACES_NORITAKESYNCSERIAL_H_
+#define UDISPLAY_INTERFACES_NORITAKESYNCSERIAL_H_
+
+#include "DisplayInterface.h"
+#include "DisplayTrace.h"
+
+#include "drivers/SPI.h"
+#include "drivers/DigitalIn.h"
+#include "FastDigitalOut.h"
+#include "rtos/ThisThread.h"
+#include "platform/mbed_wait_api.h"
+#include "hal/us_ticker_api.h"
+
+#if defined(DEVICE_SPI)
+
+/** First byte of a data write sequence */
+#define NORITAKE_SYNC_DATA_WRITE		0x44
+
+/** First byte of a data read sequence */
+#define NORITAKE_SYNC_DATA_READ			0x54
+
+/** First byte of a status read sequence */
+#define NORITAKE_SYNC_STATUS_READ		0x58
+
+/** Status bits */
+#define NORITAKE_SYNC_STATUS_BUSY		0x80
+#define NORITAKE_SYNC_STATUS_INVALID	0x40
+#define NORITAKE_SYNC_STATUS_TX_LEN		0x3F
+
+/** SCK high and low times are at least 200ns */
+#ifndef NORITAKE_SYNC_DEFAULT_HZ
+#define NORITAKE_SYNC_DEFAULT_HZ		2000000
+#endif
+
+/** SPI mode of the module (clock idles high, data sampled on the rising edge) */
+#ifndef NORITAKE_SYNC_SPI_MODE
+#define NORITAKE_SYNC_SPI_MODE			3
+#endif
+
+/**
+ * Size of the module receive buffer.
+ * MBUSY is released only when the buffer is empty, so this many bytes can
+ * be sent after MBUSY was seen released without checking it again
+ */
+#ifndef NORITAKE_SYNC_RX_BUFFER_SIZE
+#define NORITAKE_SYNC_RX_BUFFER_SIZE	60
+#endif
+
+/** Time the module may take to assert MBUSY after receiving a byte */
+#ifndef NORITAKE_SYNC_BUSY_DELAY_US
+#define NORITAKE_SYNC_BUSY_DELAY_US		2
+#endif
+
+/** Time MBUSY is polled before the calling thread sleeps between checks */
+#ifndef NORITAKE_SYNC_BUSY_SPIN_US
+#define NORITAKE_SYNC_BUSY_SPIN_US		50
+#endif
+
+/**
+ * Clocked synchronous serial interface for Noritake GU-D modules
+ *
+ * The module is an SPI slave. Each chip select assertion is one sequence,
+ * started by an operation byte (data write, data read or status read).
+ * Data is sent MSB first, so no bit reversal is needed.
+ *
+ * The module asserts MBUSY while its receive buffer holds data. Bytes are
+ * sent without checking MBUSY until the buffer could be full, then
+ * transmission pauses (in the calling thread) until MBUSY is released.
+ */
+class NoritakeSyncSerial : public DisplayInterface
+{
+	public:
+
+		/**
+		 * Instantiate a synchronous serial interface
+		 * @note This constructor does not allow a shared SPI bus
+		 *
+		 * @param[in] mosi MOSI pin for interface
+		 * @param[in] miso MISO pin for interface (NC if responses aren't read)
+		 * @param[in] sclk SCLK pin for interface
+		 * @param[in] cs Chip select pin for interface
+		 * @param[in] busy MBUSY input pin
+		 * @param[in] hz (optional) SPI frequency
+		 */
+		NoritakeSyncSerial(PinName mosi, PinName miso, PinName sclk, PinName cs, PinName busy,
+				int hz = NORITAKE_SYNC_DEFAULT_HZ) :
+			_chip_select(cs, 1), _busy(busy), _shared_bus(false),
+			_unconfirmed(NORITAKE_SYNC_RX_BUFFER_SIZE)
+		{
+			_spi = new mbed::SPI(mosi, miso, sclk, NC);
+			_spi->format(8, NORITAKE_SYNC_SPI_MODE);
+			_spi->frequency(hz);
+		}
+
+		/**
+		 * Instantiate a synchronous serial interface
+		 * @note This constructor allows a shared SPI bus.
+		 * The bus must be configured for the module (mode 3, MSB first)
+		 *
+		 * @param[in] spi Shared SPI bus handle
+		 * @param[in] cs Chip select pin for interface
+		 * @param[in] busy MBUSY input pin
+		 */
+		NoritakeSyncSerial(mbed::SPI* spi, PinName cs, PinName busy) :
+			_spi(spi), _chip_select(cs, 1), _busy(busy), _shared_bus(true),
+			_unconfirmed(NORITAKE_SYNC_RX_BUFFER_SIZE)
+		{
+		}
+
+		virtual ~NoritakeSyncSerial(void)
+		{
+			// If it's an unshared bus then we instantiated the driver
+			// So we are responsible for deleting it
+			if(!_shared_bus && _spi)
+			{
+				delete _spi;
+				_spi = NULL;
+			}
+		}
+
+		/**
+		 * Writes a single-byte to the display interface
+		 * @param[in] data Single byte to send to the display interface
+		 * @param[in] is_cmd Is the byte a command (true) or data (false)?
+		 */
+		virtual void write(uint8_t data, bool is_cmd = true) {
+			this->write(&data, (is_cmd ? 1 : 0), 1);
+		}
+
+		/**
+		 * Writes a buffer to the display interface
+		 * @note Commands are framed in-band, there is no data/cmd line
+		 * @param[in] buffer pointer to buffer of bytes to transmit
+		 * @param[in] num_cmd_bytes Number of command bytes at beginning of buffer
+		 * @param[in] buf_len Total number of bytes in payload buffer
+		 */
+		virtual void write(const uint8_t* buffer, uint32_t num_cmd_bytes, uint32_t buf_len) {
+			if(buf_len == 0) {
+				return;
+			}
+			UDISPLAY_TRACE_START(trace_start);
+			_spi->lock();
+			_chip_select = 0;
+			uint32_t blocked_start = DisplayStats::now();
+			if(is_busy()) {
+				// Still processing (eg: after a reset)
+				wait_ready();
+			}
+			_spi->write(NORITAKE_SYNC_DATA_WRITE);
+			const uint8_t* next = buffer;
+			uint32_t remaining = buf_len;
+			while(remaining) {
+				if(_unconfirmed >= NORITAKE_SYNC_RX_BUFFER_SIZE) {
+					wait_ready();
+				}
+				uint32_t chunk = NORITAKE_SYNC_RX_BUFFER_SIZE - _unconfirmed;
+				if(chunk > remaining) {
+					chunk = remaining;
+				}
+				if(chunk == 1) {
+					_spi->write(*next);
+				} else {
+					_spi->write((const char*) next, chunk, NULL, 0);
+				}
+				_unconfirmed += chunk;
+				next += chunk;
+				remaining -= chunk;
+			}
+			_stats.record_blocked(blocked_start);
+			_chip_select = 1;
+			_spi->unlock();
+			_stats.record_transaction(num_cmd_bytes, buf_len);
+			UDISPLAY_TRACE_LOG(trace_start, buffer, num_cmd_bytes, buf_len);
+		}
+
+		/**
+		 * Reads the bytes the module has to transmit (eg: responses)
+		 * @param[out] buffer to fill with data
+		 * @param[in] size Size of buffer
+		 * @retval actual number of bytes read
+		 */
+		virtual uint8_t read(uint8_t* buffer, uint32_t size) {
+			uint8_t status = read_status();
+			if(status & NORITAKE_SYNC_STATUS_INVALID) {
+				return 0;
+			}
+
+			uint32_t available = (status & NORITAKE_SYNC_STATUS_TX_LEN);
+			if(available == 0) {
+				return 0;
+			}
+
+			// The module transmits every byte reported, extra ones are discarded
+			_spi->lock();
+			_chip_select = 0;
+			_spi->write(NORITAKE_SYNC_DATA_READ);
+			_spi->write(0x00);
+			uint32_t count = 0;
+			for(uint32_t i = 0; i < available; i++) {
+				uint8_t byte = (uint8_t) _spi->write(0x00);
+				if(count < size) {
+					buffer[count++] = byte;
+				}
+			}
+			_chip_select = 1;
+			_spi->unlock();
+			return (uint8_t) count;
+		}
+
+		/**
+		 * Reads the module status
+		 * @retval status byte (MBUSY, invalid flag and number of bytes to transmit)
+		 */
+		uint8_t read_status(void) {
+			_spi->lock();
+			_chip_select = 0;
+			_spi->write(NORITAKE_SYNC_STATUS_READ);
+			uint8_t status = (uint8_t) _spi->write(0x00);
+			_chip_select = 1;
+			_spi->unlock();
+			return status;
+		}
+
+		/**
+		 * Checks if the module asserts MBUSY
+		 */
+		bool is_busy(void) {
+			return (_busy.read() == 1);
+		}
+
+		/**
+		 * Sets the frequency of the underlying SPI interface
+		 */
+		void frequency(int hz)
+		{
+			_spi->frequency(hz);
+		}
+
+	protected:
+
+		/**
+		 * Blocks until the module releases MBUSY (its receive buffer is empty)
+		 * Spins briefly, then sleeps between checks (eg: while the module resets)
+		 */
+		void wait_ready(void)
+		{
+			// Let MBUSY reflect the last byte sent
+			wait_us(NORITAKE_SYNC_BUSY_DELAY_US);
+			uint32_t start = us_ticker_read();
+			while(is_busy()) {
+				if((us_ticker_read() - start) >= NORITAKE_SYNC_BUSY_SPIN_US) {
+					rtos::ThisThread::sleep_for(1);
+				}
+			}
+			_unconfirmed = 0;
+		}
+
+		/** Interface SPI bus handle */
+		mbed::SPI* _spi;
+
+		/** Chip select output */
+		FastDigitalOut _chip_select;
+
+		/** MBUSY input */
+		mbed::DigitalIn _busy;
+
+		/** Indicates if the SPI bus is shared */
+		const bool _shared_bus;
+
+		/** Bytes sent since MBUSY was last seen released */
+		uint32_t _unconfirmed;
+
+};
+
+#endif
+
+#endif /* UDISPLAY_INTERFACES_NORITAKESYNCSERIAL_H_ */
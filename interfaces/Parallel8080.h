@@ -0,0 +1,269 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UDISPLAY_INTERFACES_PARALLEL8080_H_
+#define UDISPLAY_INTERFACES_PARALLEL8080_H_
+
+#include "DisplayInterface.h"
+#include "DisplayTrace.h"
+#include "MIPIDCS.h"
+
+#include "PinNames.h"
+
+#if defined(DEVICE_PORTOUT)
+#include "drivers/PortOut.h"
+#include "FastDigitalOut.h"
+#endif
+
+/** Low logic level on RS (D/C) pin means command */
+#define PARALLEL8080_COMMAND_LOGIC_LEVEL	0
+
+/** High logic level on RS (D/C) pin means data */
+#define PARALLEL8080_DATA_LOGIC_LEVEL		1
+
+#if defined(DEVICE_PORTOUT)
+
+/**
+ * 8080 bus on consecutive pins of a single GPIO port
+ *
+ * A bus type used with Parallel8080 owns the data and control lines and must provide:
+ * - a static const uint32_t width (8 or 16)
+ * - void write(uint32_t value), driving the data lines with the
+ *   lowest width bits of value
+ * - void strobe_write(void), pulsing WR low then high (the panel latches
+ *   the data lines on the rising edge)
+ * - void set_rs(int level), driving RS (D/C)
+ * - void select(bool selected), asserting (low) or releasing CS
+ *
+ * Any class with this shape can be used, eg: a simulated bus on a host.
+ *
+ * @tparam Width Number of data lines (8 or 16)
+ */
+template<uint32_t Width>
+class MbedPortBus
+{
+	public:
+
+		static const uint32_t width = Width;
+
+		/**
+		 * @param[in] port Port the data lines are connected to
+		 * @param[in] shift Port bit of data line D0
+		 * @param[in] wr Write strobe pin
+		 * @param[in] rs Register select (Data/Command) pin
+		 * @param[in] cs (optional) Chip select pin
+		 * @param[in] rd (optional) Read strobe pin, held inactive
+		 */
+		MbedPortBus(PortName port, uint32_t shift, PinName wr, PinName rs,
+				PinName cs = NC, PinName rd = NC) :
+			_port(port, (((1UL << Width) - 1) << shift)), _shift(shift),
+			_write_strobe(wr, 1), _register_select(rs, PARALLEL8080_DATA_LOGIC_LEVEL),
+			_chip_select(cs, 1), _read_strobe(rd, 1) {
+		}
+
+		/**
+		 * Drives the data lines
+		 * @param[in] value Value to put on the bus
+		 */
+		void write(uint32_t value) {
+			_port.write(value << _shift);
+		}
+
+		/**
+		 * Latches the data lines into the panel with a WR pulse
+		 */
+		void strobe_write(void) {
+			_write_strobe = 0;
+			_write_strobe = 1;
+		}
+
+		/**
+		 * Drives the register select (Data/Command) line
+		 * @param[in] level PARALLEL8080_COMMAND_LOGIC_LEVEL or PARALLEL8080_DATA_LOGIC_LEVEL
+		 */
+		void set_rs(int level) {
+			_register_select = level;
+		}
+
+		/**
+		 * Asserts or releases chip select
+		 * @param[in] selected true to select the panel
+		 */
+		void select(bool selected) {
+			_chip_select = (selected ? 0 : 1);
+		}
+
+	private:
+
+		mbed::PortOut _port;
+
+		const uint32_t _shift;
+
+		/** Write strobe, the panel latches the bus on its rising edge */
+		FastDigitalOut _write_strobe;
+
+		/** Register select (Data/Command) output */
+		FastDigitalOut _register_select;
+
+		/** Chip select output */
+		FastDigitalOut _chip_select;
+
+		/** Read strobe, held inactive */
+		FastDigitalOut _read_strobe;
+
+};
+
+#endif
+
+/**
+ * Intel 8080 (i80) style parallel display interface
+ *
+ * A byte (or word) is latched by the panel on each rising edge of WR,
+ * and the RS pin selects between command and data.
+ *
+ * On a 16-bit bus, commands and their parameters use the low 8 data lines,
+ * one byte per strobe. Pixel data written after a MIPI DCS memory write
+ * command (RAMWR/RAMWRC) is packed two bytes per strobe, first byte on the
+ * high data lines. An odd trailing pixel byte is held back and paired with
+ * the first byte of the next data write, so pixels may be split across
+ * writes; it is sent alone (on the high lines) if a command comes first.
+ *
+ * @note The bus and strobe timing must meet the panel's write cycle
+ * requirements. Reads are not supported.
+ *
+ * @tparam Bus Bus type driving the data and control lines (see MbedPortBus)
+ */
+template<typename Bus>
+class Parallel8080 : public DisplayInterface
+{
+	public:
+
+		/**
+		 * Instantiate a parallel display interface
+		 * @param[in] bus Data and control lines
+		 */
+		Parallel8080(Bus& bus) : _bus(bus), _pixel_data(false),
+			_has_carry(false), _carry(0)
+		{
+		}
+
+		virtual ~Parallel8080(void) { }
+
+		/**
+		 * Writes a single-byte to the display interface
+		 * @param[in] data Single byte to send to the display interface
+		 * @param[in] is_cmd Is the byte a command (true) or data (false)?
+		 */
+		virtual void write(uint8_t data, bool is_cmd = true) {
+			this->write(&data, (is_cmd ? 1 : 0), 1);
+		}
+
+		/**
+		 * Writes a buffer to the display interface
+		 * @param[in] buffer pointer to buffer of bytes to transmit
+		 * @param[in] num_cmd_bytes Number of command bytes at beginning of buffer
+		 * @param[in] buf_len Total number of bytes in payload buffer
+		 */
+		virtual void write(const uint8_t* buffer, uint32_t num_cmd_bytes, uint32_t buf_len) {
+			UDISPLAY_TRACE_START(trace_start);
+			_bus.select(true);
+			uint32_t blocked_start = DisplayStats::now();
+
+			if(num_cmd_bytes) {
+				if(_has_carry) {
+					// The memory write ends on half a word
+					strobe(_carry << 8);
+					_has_carry = false;
+				}
+				_bus.set_rs(PARALLEL8080_COMMAND_LOGIC_LEVEL);
+				for(uint32_t i = 0; i < num_cmd_bytes; i++) {
+					strobe(buffer[i]);
+				}
+				uint8_t last = buffer[num_cmd_bytes - 1];
+				_pixel_data = (last == MIPI_DCS_WRITE_MEMORY_START ||
+						last == MIPI_DCS_WRITE_MEMORY_CONTINUE);
+				_bus.set_rs(PARALLEL8080_DATA_LOGIC_LEVEL);
+			}
+
+			write_data(buffer + num_cmd_bytes, (buf_len - num_cmd_bytes));
+
+			_stats.record_blocked(blocked_start);
+			_bus.select(false);
+			_stats.record_transaction(num_cmd_bytes, buf_len);
+			UDISPLAY_TRACE_LOG(trace_start, buffer, num_cmd_bytes, buf_len);
+		}
+
+		/**
+		 * Reads a buffer from the display interface
+		 * @note: May not be available
+		 * @param[out] buffer to fill with data
+		 * @param[in] size Size of buffer
+		 * @retval actual number of bytes read (may always be 0 if unsupported)
+		 */
+		virtual uint8_t read(uint8_t* buffer, uint32_t size) { return 0; } // Not supported
+
+	protected:
+
+		/**
+		 * Writes the data phase of a transaction (RS set to data)
+		 */
+		void write_data(const uint8_t* data, uint32_t length) {
+			if(Bus::width == 16 && _pixel_data) {
+				uint32_t i = 0;
+				if(_has_carry && length) {
+					strobe((_carry << 8) | data[0]);
+					_has_carry = false;
+					i = 1;
+				}
+				for(; (i + 1) < length; i += 2) {
+					strobe((data[i] << 8) | data[i + 1]);
+				}
+				if(i < length) {
+					// Pair it with the next data write
+					_carry = data[i];
+					_has_carry = true;
+				}
+			} else {
+				for(uint32_t i = 0; i < length; i++) {
+					strobe(data[i]);
+				}
+			}
+		}
+
+		/**
+		 * Puts a value on the bus and latches it with a WR pulse
+		 */
+		void strobe(uint32_t value) {
+			_bus.write(value);
+			_bus.strobe_write();
+		}
+
+		/** Data and control lines */
+		Bus& _bus;
+
+		/** Indicates if data bytes are pixels (after a memory write command) */
+		bool _pixel_data;
+
+		/** Indicates if a pixel byte is waiting for its pair (16-bit bus) */
+		bool _has_carry;
+
+		/** Pixel byte waiting for its pair */
+		uint8_t _carry;
+
+};
+
+#endif /* UDISPLAY_INTERFACES_PARALLEL8080_H_ */
@@ -0,0 +1,296 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UDISPLAY_INTERFACES_SPI3WIRE_H_
+#define UDISPLAY_INTERFACES_SPI3WIRE_H_
+
+#include "DisplayInterface.h"
+#include "DisplayTrace.h"
+#include "NineBitPacker.h"
+
+#include "drivers/SPI.h"
+#include "FastDigitalOut.h"
+
+#if defined(DEVICE_SPI_ASYNCH)
+#include "rtos/EventFlags.h"
+#endif
+
+#if defined(DEVICE_SPI)
+
+/**
+ * Size of each packed transfer buffer
+ * A multiple of 9 bytes (8 words) keeps transfers aligned on word groups
+ */
+#ifndef SPI3WIRE_PACKED_BUFFER_SIZE
+#define SPI3WIRE_PACKED_BUFFER_SIZE		288
+#endif
+
+/**
+ * Packed transfers at least this long use an asynchronous (DMA) transfer
+ * on targets that support it, shorter ones aren't worth the setup cost
+ */
+#ifndef SPI3WIRE_ASYNC_MIN_BYTES
+#define SPI3WIRE_ASYNC_MIN_BYTES		64
+#endif
+
+#define SPI3WIRE_XFER_DONE_FLAG			0x1
+
+/**
+ * 3-wire (9-bit) SPI display interface driver
+ *
+ * For panels without a D/C pin: every byte is sent as a 9-bit word
+ * prefixed by its D/C bit. Words are packed into a byte stream
+ * (8 words in 9 bytes) by NineBitPacker, so the bus runs with ordinary
+ * 8-bit frames.
+ *
+ * On targets with asynchronous SPI (DEVICE_SPI_ASYNCH), two packed buffers
+ * are used: one is packed while the other is sent with mbed::SPI::transfer().
+ */
+class SPI3Wire : public DisplayInterface
+{
+	public:
+
+		/**
+		 * Instantiate a 3-wire SPI display interface
+		 * @note This constructor does not allow a shared SPI bus
+		 *
+		 * @param[in] mosi MOSI (SDA) pin for interface
+		 * @param[in] miso MISO pin for interface
+		 * @param[in] sclk SCLK pin for interface
+		 * @param[in] cs Chip select pin for interface
+		 */
+		SPI3Wire(PinName mosi, PinName miso, PinName sclk, PinName cs) :
+			_chip_select(cs, 1), _shared_bus(false), _current(0), _fill(0), _xfer_busy(false)
+		{
+			_spi = new mbed::SPI(mosi, miso, sclk, NC);
+#if defined(DEVICE_SPI_ASYNCH)
+			_spi->set_dma_usage(DMA_USAGE_OPPORTUNISTIC);
+#endif
+		}
+
+		/**
+		 * Instantiate a 3-wire SPI display interface
+		 * @note This constructor allows a shared SPI bus.
+		 *
+		 * @param[in] spi Shared SPI bus handle
+		 * @param[in] cs Chip select pin for interface
+		 */
+		SPI3Wire(mbed::SPI* spi, PinName cs) :
+			_spi(spi), _chip_select(cs, 1), _shared_bus(true), _current(0), _fill(0), _xfer_busy(false)
+		{
+		}
+
+		virtual ~SPI3Wire(void)
+		{
+			// If it's an unshared bus then we instantiated the driver
+			// So we are responsible for deleting it
+			if(!_shared_bus && _spi)
+			{
+				delete _spi;
+				_spi = NULL;
+			}
+		}
+
+		/**
+		 * Writes a single-byte to the display interface
+		 * @param[in] data Single byte to send to the display interface
+		 * @param[in] is_cmd Is the byte a command (true) or data (false)?
+		 */
+		virtual void write(uint8_t data, bool is_cmd = true) {
+			this->write(&data, (is_cmd ? 1 : 0), 1);
+		}
+
+		/**
+		 * Writes a buffer to the display interface
+		 * @param[in] buffer pointer to buffer of bytes to transmit
+		 * @param[in] num_cmd_bytes Number of command bytes at beginning of buffer
+		 * @param[in] buf_len Total number of bytes in payload buffer
+		 */
+		virtual void write(const uint8_t* buffer, uint32_t num_cmd_bytes, uint32_t buf_len) {
+			if(buf_len == 0) {
+				return;
+			}
+			UDISPLAY_TRACE_START(trace_start);
+			begin();
+			uint32_t blocked_start = DisplayStats::now();
+			pack(buffer, num_cmd_bytes, false);
+			pack(buffer + num_cmd_bytes, (buf_len - num_cmd_bytes), true);
+			end();
+			_stats.record_blocked(blocked_start);
+			_stats.record_transaction(num_cmd_bytes, buf_len);
+			UDISPLAY_TRACE_LOG(trace_start, buffer, num_cmd_bytes, buf_len);
+		}
+
+		/**
+		 * Writes rows of data spaced by a stride within a single chip select assertion
+		 * @param[in] base pointer to the first byte of the first row
+		 * @param[in] stride Distance in bytes between the start of two rows
+		 * @param[in] row_bytes Number of bytes to write from each row
+		 * @param[in] rows Number of rows
+		 */
+		virtual void write_strided(const uint8_t* base, uint32_t stride, uint32_t row_bytes, uint32_t rows) {
+			if(row_bytes == 0 || rows == 0) {
+				return;
+			}
+			UDISPLAY_TRACE_START(trace_start);
+			begin();
+			uint32_t blocked_start = DisplayStats::now();
+			for(uint32_t i = 0; i < rows; i++) {
+				pack(base + (i * stride), row_bytes, true);
+			}
+			end();
+			_stats.record_blocked(blocked_start);
+			_stats.record_transaction(0, (row_bytes * rows));
+			UDISPLAY_TRACE_LOG(trace_start, base, 0, (row_bytes * rows));
+		}
+
+		/**
+		 * Reads a buffer from the display interface
+		 * @note: May not be available
+		 * @param[out] buffer to fill with data
+		 * @param[in] size Size of buffer
+		 * @retval actual number of bytes read (may always be 0 if unsupported)
+		 */
+		virtual uint8_t read(uint8_t* buffer, uint32_t size) { return 0; } // Not supported
+
+		/**
+		 * Sets the frequency of the underlying SPI interface
+		 */
+		void frequency(int hz)
+		{
+			_spi->frequency(hz);
+		}
+
+	protected:
+
+		/** Starts a transaction */
+		void begin(void)
+		{
+			_spi->lock();
+			_chip_select = 0;
+			_packer.reset();
+			_fill = 0;
+		}
+
+		/** Sends the rest of the packed stream and ends the transaction */
+		void end(void)
+		{
+			_fill += _packer.flush(&_packed[_current][_fill]);
+			send_packed();
+			wait_idle();
+			_chip_select = 1;
+			_spi->unlock();
+		}
+
+		/**
+		 * Packs words into the current buffer, sending it whenever it is full
+		 */
+		void pack(const uint8_t* in, uint32_t count, bool is_data)
+		{
+			while(count) {
+				uint32_t space = SPI3WIRE_PACKED_BUFFER_SIZE - _fill;
+				uint32_t words = ((space * 8) - _packer.pending_bits()) / 9;
+				if(words == 0) {
+					send_packed();
+					continue;
+				}
+				if(words > count) {
+					words = count;
+				}
+				_fill += _packer.pack(in, words, is_data, &_packed[_current][_fill]);
+				in += words;
+				count -= words;
+			}
+		}
+
+		/** Sends the current packed buffer and switches to the other one */
+		void send_packed(void)
+		{
+			if(_fill == 0) {
+				return;
+			}
+			wait_idle();
+#if defined(DEVICE_SPI_ASYNCH)
+			if(_fill >= SPI3WIRE_ASYNC_MIN_BYTES) {
+				_xfer_evt.clear(SPI3WIRE_XFER_DONE_FLAG);
+				// Fall through to a blocking write if the transfer could not start
+				if(_spi->transfer(_packed[_current], (int) _fill, (uint8_t*) NULL, 0,
+						mbed::callback(this, &SPI3Wire::xfer_event),
+						(SPI_EVENT_COMPLETE | SPI_EVENT_ERROR)) == 0) {
+					_xfer_busy = true;
+					_current ^= 1;
+					_fill = 0;
+					return;
+				}
+			}
+#endif
+			_spi->write((const char*) _packed[_current], _fill, NULL, 0);
+			_fill = 0;
+		}
+
+		/** Waits for the transfer in progress, if any */
+		void wait_idle(void)
+		{
+#if defined(DEVICE_SPI_ASYNCH)
+			if(_xfer_busy) {
+				_xfer_evt.wait_any(SPI3WIRE_XFER_DONE_FLAG);
+				_xfer_busy = false;
+			}
+#endif
+		}
+
+#if defined(DEVICE_SPI_ASYNCH)
+		/** Asynchronous transfer event handler (interrupt context) */
+		void xfer_event(int event)
+		{
+			_xfer_evt.set(SPI3WIRE_XFER_DONE_FLAG);
+		}
+#endif
+
+		/** Interface SPI bus handle */
+		mbed::SPI* _spi;
+
+		/** Chip select output */
+		FastDigitalOut _chip_select;
+
+		/** Indicates if the SPI bus is shared */
+		const bool _shared_bus;
+
+		NineBitPacker _packer;
+
+		/** Packed transfer buffers (the second one is only used with asynchronous SPI) */
+		uint8_t _packed[2][SPI3WIRE_PACKED_BUFFER_SIZE];
+
+		/** Buffer being packed */
+		uint32_t _current;
+
+		/** Number of packed bytes in the current buffer */
+		uint32_t _fill;
+
+		/** Indicates if an asynchronous transfer is in progress */
+		bool _xfer_busy;
+
+#if defined(DEVICE_SPI_ASYNCH)
+		/** Set when an asynchronous transfer completes */
+		rtos::EventFlags _xfer_evt;
+#endif
+
+};
+
+#endif
+
+#endif /* UDISPLAY_INTERFACES_SPI3WIRE_H_ */
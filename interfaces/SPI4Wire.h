@@ -19,9 +19,16 @@
 #define MBED_LVGL_DRIVERS_INTERFACES_SPI4WIRE_H_
 
 #include "DisplayInterface.h"
+#include "DisplayTrace.h"
+#include "SPIBusArbiter.h"
 
 #include "drivers/SPI.h"
-#include "drivers/DigitalOut.h"
+#include "platform/mbed_assert.h"
+#include "FastDigitalOut.h"
+
+#if defined(DEVICE_SPI_ASYNCH)
+#include "rtos/EventFlags.h"
+#endif
 
 #if defined(DEVICE_SPI)
 
@@ -31,11 +38,26 @@
 /** High logic level on D/C pin means data */
 #define SPI4WIRE_DATA_LOGIC_LEVEL		1
 
+/**
+ * Data phases at least this long use an asynchronous (DMA) transfer
+ * on targets that support it, shorter ones aren't worth the setup cost
+ */
+#ifndef SPI4WIRE_ASYNC_MIN_BYTES
+#define SPI4WIRE_ASYNC_MIN_BYTES		64
+#endif
+
+#define SPI4WIRE_XFER_DONE_FLAG			0x1
+
 /**
  * 4-wire SPI display interface driver
  * This type of interface is supported by all mbed targets
  * that support SPI and GPIO digital outputs (almost universal).
  * That means it does not need a HAL interface
+ *
+ * On targets with asynchronous SPI (DEVICE_SPI_ASYNCH), long data phases
+ * are sent with mbed::SPI::transfer(), using DMA where available, and the
+ * calling thread blocks on an event instead of pushing bytes.
+ * Command phases are always written synchronously.
  */
 class SPI4Wire : public DisplayInterface
 {
@@ -52,22 +74,28 @@ class SPI4Wire : public DisplayInterface
 		 * @param[in] dc Data/Command pin for interface
 		 */
 		SPI4Wire(PinName mosi, PinName miso, PinName sclk, PinName cs, PinName dc) :
-			_chip_select(cs, 1), _data_command(dc, 0), _shared_bus(false)
+			_chip_select(cs, 1), _data_command(dc, 0), _shared_bus(false),
+			_arbiter(NULL), _client(SPI_ARBITER_INVALID_CLIENT), _batching(false), _holding_bus(false)
 		{
 			_spi = new mbed::SPI(mosi, miso, sclk, NC);
+#if defined(DEVICE_SPI_ASYNCH)
+			_spi->set_dma_usage(DMA_USAGE_OPPORTUNISTIC);
+#endif
 		}
 
 		/**
 		 * Instantiate a 4-wire SPI display interface
 		 * @note This constructor allows a shared SPI bus.
 		 * Not recommended for maximum drawing rate.
+		 * Use set_arbiter() to control how the bus is shared.
 		 *
 		 * @param[in] spi Shared SPI bus handle
 		 * @param[in] cs Chip select pin for interface
 		 * @param[in] dc Data/Command pin for interface
 		 */
 		SPI4Wire(mbed::SPI* spi, PinName cs, PinName dc) :
-			_chip_select(cs, 1), _data_command(dc, 0), _shared_bus(true)
+			_chip_select(cs, 1), _data_command(dc, 0), _shared_bus(true),
+			_arbiter(NULL), _client(SPI_ARBITER_INVALID_CLIENT), _batching(false), _holding_bus(false)
 		{
 			_spi = spi;
 		}
@@ -89,16 +117,21 @@ class SPI4Wire : public DisplayInterface
 		 * @param[in] is_cmd Is the byte a command (true) or data (false)?
 		 */
 		virtual void write(uint8_t data, bool is_cmd = true) {
-			_spi->lock();
+			UDISPLAY_TRACE_START(trace_start);
+			bus_acquire();
 			_chip_select = 0;
 			if(is_cmd) {
 				_data_command = SPI4WIRE_COMMAND_LOGIC_LEVEL;
 			} else {
 				_data_command = SPI4WIRE_DATA_LOGIC_LEVEL;
 			}
+			uint32_t blocked_start = DisplayStats::now();
 			_spi->write(data);
+			_stats.record_blocked(blocked_start);
 			_chip_select = 1;
-			_spi->unlock();
+			bus_release();
+			_stats.record_transaction((is_cmd ? 1 : 0), 1);
+			UDISPLAY_TRACE_LOG(trace_start, &data, (is_cmd ? 1 : 0), 1);
 		}
 
 		/**
@@ -108,16 +141,44 @@ class SPI4Wire : public DisplayInterface
 		 * @param[in] buf_len Total number of bytes in payload buffer
 		 */
 		virtual void write(const uint8_t* buffer, uint32_t num_cmd_bytes, uint32_t buf_len) {
-			_spi->lock();
+			UDISPLAY_TRACE_START(trace_start);
+			bus_acquire();
 			_chip_select = 0;
+			uint32_t blocked_start = DisplayStats::now();
 			if(num_cmd_bytes) {
 				_data_command = SPI4WIRE_COMMAND_LOGIC_LEVEL;
 				_spi->write((const char*) buffer, num_cmd_bytes, NULL, 0);
 			}
 			_data_command = SPI4WIRE_DATA_LOGIC_LEVEL;
-			_spi->write((const char*)(buffer+num_cmd_bytes), (buf_len - num_cmd_bytes), NULL, 0);
+			write_data(buffer + num_cmd_bytes, (buf_len - num_cmd_bytes));
+			_stats.record_blocked(blocked_start);
 			_chip_select = 1;
-			_spi->unlock();
+			bus_release();
+			_stats.record_transaction(num_cmd_bytes, buf_len);
+			UDISPLAY_TRACE_LOG(trace_start, buffer, num_cmd_bytes, buf_len);
+		}
+
+		/**
+		 * Writes rows of data spaced by a stride within a single chip select assertion
+		 * @param[in] base pointer to the first byte of the first row
+		 * @param[in] stride Distance in bytes between the start of two rows
+		 * @param[in] row_bytes Number of bytes to write from each row
+		 * @param[in] rows Number of rows
+		 */
+		virtual void write_strided(const uint8_t* base, uint32_t stride, uint32_t row_bytes, uint32_t rows) {
+			UDISPLAY_TRACE_START(trace_start);
+			bus_acquire();
+			_chip_select = 0;
+			_data_command = SPI4WIRE_DATA_LOGIC_LEVEL;
+			uint32_t blocked_start = DisplayStats::now();
+			for(uint32_t i = 0; i < rows; i++) {
+				write_data(base + (i * stride), row_bytes);
+			}
+			_stats.record_blocked(blocked_start);
+			_chip_select = 1;
+			bus_release();
+			_stats.record_transaction(0, (row_bytes * rows));
+			UDISPLAY_TRACE_LOG(trace_start, base, 0, (row_bytes * rows));
 		}
 
 		/**
@@ -137,20 +198,122 @@ class SPI4Wire : public DisplayInterface
 			_spi->frequency(hz);
 		}
 
+		/**
+		 * Arbitrates access to a shared SPI bus through a bus arbiter
+		 * @param[in] arbiter Arbiter of the shared bus (NULL to stop using it),
+		 * must arbitrate the bus this interface was constructed with
+		 * @param[in] client Client ID of this interface on the arbiter
+		 */
+		void set_arbiter(SPIBusArbiter* arbiter, SPIBusArbiter::client_id_t client)
+		{
+			MBED_ASSERT(arbiter == NULL || &arbiter->spi() == _spi);
+			end_batch();
+			_arbiter = arbiter;
+			_client = client;
+		}
+
+		/**
+		 * Starts a batch of transactions (eg: a frame)
+		 * @note Only has an effect when using a bus arbiter. The bus is kept
+		 * between transactions of the batch until the arbiter asks for it
+		 */
+		void begin_batch(void)
+		{
+			_batching = true;
+		}
+
+		/**
+		 * Ends a batch of transactions and releases the bus
+		 */
+		void end_batch(void)
+		{
+			_batching = false;
+			if(_holding_bus) {
+				_arbiter->release(_client);
+				_holding_bus = false;
+			}
+		}
+
 	protected:
 
+		/**
+		 * Writes the data phase of a transaction (bus acquired, D/C set)
+		 */
+		void write_data(const uint8_t* data, uint32_t length)
+		{
+#if defined(DEVICE_SPI_ASYNCH)
+			if(length >= SPI4WIRE_ASYNC_MIN_BYTES) {
+				_xfer_evt.clear(SPI4WIRE_XFER_DONE_FLAG);
+				// Only wait for the event if the transfer was started,
+				// fall back to a blocking write if the bus is busy
+				if(_spi->transfer(data, (int) length, (uint8_t*) NULL, 0,
+						mbed::callback(this, &SPI4Wire::xfer_event),
+						(SPI_EVENT_COMPLETE | SPI_EVENT_ERROR)) == 0) {
+					_xfer_evt.wait_any(SPI4WIRE_XFER_DONE_FLAG);
+					return;
+				}
+			}
+#endif
+			_spi->write((const char*) data, length, NULL, 0);
+		}
+
+#if defined(DEVICE_SPI_ASYNCH)
+		/** Asynchronous transfer event handler (interrupt context) */
+		void xfer_event(int event)
+		{
+			_xfer_evt.set(SPI4WIRE_XFER_DONE_FLAG);
+		}
+#endif
+
+		/** Gets exclusive access to the bus for a transaction */
+		void bus_acquire(void)
+		{
+			if(_arbiter && !_holding_bus) {
+				_arbiter->acquire(_client);
+				_holding_bus = true;
+			}
+			_spi->lock();
+		}
+
+		/** Ends a transaction, giving the bus back to the arbiter if needed */
+		void bus_release(void)
+		{
+			_spi->unlock();
+			if(_holding_bus && (!_batching || _arbiter->should_yield(_client))) {
+				_arbiter->release(_client);
+				_holding_bus = false;
+			}
+		}
+
 		/** Interface SPI bus handle */
 		mbed::SPI* _spi;
 
 		/** Chip select output */
-		mbed::DigitalOut _chip_select;
+		FastDigitalOut _chip_select;
 
 		/** Data/Command output */
-		mbed::DigitalOut _data_command;
+		FastDigitalOut _data_command;
 
 		/** Indicates if the SPI bus is shared */
 		const bool _shared_bus;
 
+		/** Shared bus arbiter (optional) */
+		SPIBusArbiter* _arbiter;
+
+		/** Client ID on the arbiter */
+		SPIBusArbiter::client_id_t _client;
+
+		/** Indicates if a batch of transactions is in progress */
+		bool _batching;
+
+		/** Indicates if the arbiter granted the bus to this interface */
+		bool _holding_bus;
+
+#if defined(DEVICE_SPI_ASYNCH)
+		/** Set when an asynchronous transfer completes */
+		rtos::EventFlags _xfer_evt;
+#endif
+
 };
 
 #endif
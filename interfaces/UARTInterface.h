@@ -19,16 +19,116 @@
 #define UDISPLAY_INTERFACES_UARTINTERFACE_H_
 
 #include "DisplayInterface.h"
-#include "drivers/UARTSerial.h"
+#include "DisplayTrace.h"
+
+#include "drivers/RawSerial.h"
+#include "drivers/InterruptIn.h"
+#include "rtos/EventFlags.h"
+#include "platform/Callback.h"
+#include "platform/CircularBuffer.h"
+#include "platform/mbed_critical.h"
+#include "hal/us_ticker_api.h"
 
 #if (DEVICE_SERIAL && DEVICE_INTERRUPTIN) || defined(DOXYGEN_ONLY)
 
-class UARTInterface : public mbed::UARTSerial, public DisplayInterface
+/**
+ * Interval at which the BUSY line is checked again while a write waits,
+ * in case its release edge was missed
+ */
+#ifndef UART_INTERFACE_BUSY_POLL_MS
+#define UART_INTERFACE_BUSY_POLL_MS			1
+#endif
+
+/** Maximum number of queued writes */
+#ifndef UART_INTERFACE_ASYNC_QUEUE_SIZE
+#define UART_INTERFACE_ASYNC_QUEUE_SIZE		4
+#endif
+
+/**
+ * Size of the receive buffer
+ * (Noritake GU-D modules transmit from a 60-byte buffer)
+ */
+#ifndef UART_INTERFACE_RX_BUFFER_SIZE
+#define UART_INTERFACE_RX_BUFFER_SIZE		64
+#endif
+
+/** Set each time a queued write has been sent */
+#define UART_INTERFACE_TX_DONE_FLAG			0x1
+
+/** Set each time bytes are received */
+#define UART_INTERFACE_RX_FLAG				0x2
+
+/**
+ * UART display interface
+ *
+ * Flow control:
+ * - Modules with RTS/CTS lines use the UART's hardware flow control,
+ * see mbed::SerialBase::set_flow_control() (requires DEVICE_SERIAL_FC)
+ * - Modules with a BUSY output (eg: Noritake GU-D) can have it connected
+ * to any input pin. BUSY is checked before each byte is written to the UART
+ * and transmission is paused while it is asserted (the module still accepts
+ * 2 bytes once BUSY is asserted). It resumes on the BUSY release edge.
+ *
+ * Writes are zero-copy:
+ * every write, synchronous or not, queues the caller's buffer and the UART
+ * TX interrupt sends it straight from there, one byte per interrupt in BUSY
+ * mode. write() blocks until its buffer has been sent, write_async() returns
+ * immediately and a completion callback is called once the last byte has
+ * been written to the UART. Queued writes are sent in order.
+ *
+ * Received bytes are buffered from the RX interrupt (see read()).
+ */
+class UARTInterface : public mbed::RawSerial, public DisplayInterface
 {
 public:
 
+	/**
+	 * Instantiate a UART display interface
+	 * @param[in] tx TX pin for interface
+	 * @param[in] rx RX pin for interface
+	 * @param[in] baud (optional) Initial baud rate
+	 * @param[in] busy (optional) BUSY input pin of the module
+	 * @param[in] busy_level (optional) Logic level of the BUSY pin when the module is busy
+	 */
 	UARTInterface(PinName tx, PinName rx,
-			int baud = MBED_CONF_PLATFORM_DEFAULT_SERIAL_BAUD_RATE) : mbed::UARTSerial(tx, rx, baud), DisplayInterface() { }
+			int baud = MBED_CONF_PLATFORM_DEFAULT_SERIAL_BAUD_RATE,
+			PinName busy = NC, int busy_level = 1) : mbed::RawSerial(tx, rx, baud), DisplayInterface(),
+			_busy(NULL), _busy_level(busy_level), _baud(baud),
+			_tx_head(0), _tx_count(0), _tx_queued(0), _tx_completed(0), _tx_active(false) {
+		if(busy != NC) {
+			_busy = new mbed::InterruptIn(busy);
+			if(busy_level) {
+				_busy->fall(mbed::callback(this, &UARTInterface::busy_released));
+			} else {
+				_busy->rise(mbed::callback(this, &UARTInterface::busy_released));
+			}
+		}
+		mbed::SerialBase::attach(mbed::callback(this, &UARTInterface::rx_irq), mbed::SerialBase::RxIrq);
+	}
+
+	virtual ~UARTInterface(void) {
+		// Once the interrupts are detached nothing touches the queue concurrently
+		core_util_critical_section_enter();
+		mbed::SerialBase::attach(NULL, mbed::SerialBase::RxIrq);
+		mbed::SerialBase::attach(NULL, mbed::SerialBase::TxIrq);
+		_tx_active = false;
+		core_util_critical_section_exit();
+
+		if(_busy) {
+			delete _busy;
+			_busy = NULL;
+		}
+
+		// Abandon queued writes, their buffers are no longer needed
+		while(_tx_count) {
+			mbed::Callback<void()> done = _tx[_tx_head].done;
+			_tx_head = (_tx_head + 1) % UART_INTERFACE_ASYNC_QUEUE_SIZE;
+			_tx_count--;
+			if(done) {
+				done();
+			}
+		}
+	}
 
 	/**
 	 * Writes a single-byte to the display interface
@@ -36,9 +136,13 @@ public:
 	 * @param[in] is_cmd Is the byte a command (true) or data (false)?
 	 */
 	virtual void write(uint8_t data, bool is_cmd = true) {
-		// TODO - Some displays may need a separate data pin?
-		// For now ignore the data/cmd difference
-		mbed::UARTSerial::write(&data, 1);
+		// UART displays frame commands in-band, there is no data/cmd line
+		UDISPLAY_TRACE_START(trace_start);
+		uint32_t blocked_start = DisplayStats::now();
+		transmit(&data, 1);
+		_stats.record_blocked(blocked_start);
+		_stats.record_transaction((is_cmd ? 1 : 0), 1, 0);
+		UDISPLAY_TRACE_LOG(trace_start, &data, (is_cmd ? 1 : 0), 1);
 	}
 
 	/**
@@ -48,7 +152,56 @@ public:
 	 * @param[in] buf_len Total number of bytes in payload buffer
 	 */
 	virtual void write(const uint8_t* buffer, uint32_t num_cmd_bytes, uint32_t buf_len) {
-		mbed::UARTSerial::write(buffer, buf_len);
+		UDISPLAY_TRACE_START(trace_start);
+		uint32_t blocked_start = DisplayStats::now();
+		transmit(buffer, buf_len);
+		_stats.record_blocked(blocked_start);
+		_stats.record_transaction(num_cmd_bytes, buf_len, 0);
+		UDISPLAY_TRACE_LOG(trace_start, buffer, num_cmd_bytes, buf_len);
+	}
+
+	/**
+	 * Queues a buffer to be written without blocking
+	 * @note The buffer is sent from in place and must stay valid until the
+	 * done callback is called. The callback runs in interrupt context.
+	 * If the interface is destroyed first, it is called from the destructor
+	 * without the remaining bytes being sent
+	 * @param[in] buffer pointer to buffer of bytes to transmit
+	 * @param[in] num_cmd_bytes Number of command bytes at beginning of buffer
+	 * @param[in] buf_len Total number of bytes in payload buffer
+	 * @param[in] done (optional) Called once the buffer is no longer needed
+	 * @retval true if queued, false if the queue is full
+	 */
+	bool write_async(const uint8_t* buffer, uint32_t num_cmd_bytes, uint32_t buf_len,
+			mbed::Callback<void()> done = NULL) {
+		UDISPLAY_TRACE_START(trace_start);
+		uint32_t ticket;
+		if(!enqueue(buffer, buf_len, done, ticket)) {
+			return false;
+		}
+		_stats.record_transaction(num_cmd_bytes, buf_len, 0);
+		UDISPLAY_TRACE_LOG(trace_start, buffer, num_cmd_bytes, buf_len);
+		return true;
+	}
+
+	/**
+	 * Attaches a handler called when data has been received
+	 * @note Called from interrupt context
+	 * @param[in] handler RX event handler (NULL to detach)
+	 */
+	void attach_rx(mbed::Callback<void()> handler) {
+		core_util_critical_section_enter();
+		_rx_handler = handler;
+		core_util_critical_section_exit();
+	}
+
+	/**
+	 * Blocks until every queued write has been sent
+	 */
+	void sync(void) {
+		while(_tx_count) {
+			wait_tx_done();
+		}
 	}
 
 	/**
@@ -56,12 +209,238 @@ public:
 	 * @note: May not be available
 	 * @param[out] buffer to fill with data
 	 * @param[in] size Size of buffer
-	 * @retval actual number of bytes read (may always be 0 if unsupported)
+	 * @retval actual number of bytes read (0 if nothing was received)
 	 */
 	virtual uint8_t read(uint8_t* buffer, uint32_t size) {
-		return mbed::UARTSerial::read(buffer, size);
+		uint32_t count = 0;
+		while(count < size && _rx_buffer.pop(buffer[count])) {
+			count++;
+		}
+		return count;
+	}
+
+	/**
+	 * Sets the baud rate of the UART
+	 * @param[in] baud New baud rate
+	 */
+	void set_baud(int baud) {
+		mbed::SerialBase::baud(baud);
+		_baud = baud;
+	}
+
+	/**
+	 * Gets the current baud rate of the UART
+	 */
+	int get_baud(void) const {
+		return _baud;
+	}
+
+	/**
+	 * Reads bytes, giving up after a timeout (eg: waiting for a module response)
+	 * @param[out] buffer to fill with data
+	 * @param[in] size Number of bytes to read
+	 * @param[in] timeout_ms Maximum time to wait for all the bytes
+	 * @retval number of bytes read
+	 */
+	uint32_t read_timeout(uint8_t* buffer, uint32_t size, uint32_t timeout_ms) {
+		uint32_t count = 0;
+		uint32_t start = us_ticker_read();
+		while(count < size) {
+			_rx_evt.clear(UART_INTERFACE_RX_FLAG);
+			if(_rx_buffer.pop(buffer[count])) {
+				count++;
+				continue;
+			}
+			uint32_t elapsed_ms = (us_ticker_read() - start) / 1000;
+			if(elapsed_ms >= timeout_ms) {
+				break;
+			}
+			_rx_evt.wait_any(UART_INTERFACE_RX_FLAG, (timeout_ms - elapsed_ms));
+		}
+		return count;
+	}
+
+	/**
+	 * Discards any bytes received and not read yet
+	 */
+	void flush_input(void) {
+		_rx_buffer.reset();
+	}
+
+	/**
+	 * Checks if the module asserts its BUSY line
+	 * @retval true if busy, false if ready (or no BUSY pin is used)
+	 */
+	bool is_busy(void) {
+		return (_busy && (_busy->read() == _busy_level));
+	}
+
+protected:
+
+	/**
+	 * Sends a buffer from in place and blocks until it has been sent
+	 */
+	void transmit(const uint8_t* data, uint32_t length) {
+		uint32_t ticket;
+		while(!enqueue(data, length, NULL, ticket)) {
+			wait_tx_done();
+		}
+		while((int32_t) (_tx_completed - ticket) <= 0) {
+			wait_tx_done();
+		}
+	}
+
+	/**
+	 * Queues a buffer and starts the TX interrupt if it is stopped
+	 * @param[out] ticket Value _tx_completed reaches once the buffer is sent
+	 * @retval true if queued, false if the queue is full
+	 */
+	bool enqueue(const uint8_t* buffer, uint32_t length,
+			mbed::Callback<void()> done, uint32_t& ticket) {
+		core_util_critical_section_enter();
+		if(_tx_count == UART_INTERFACE_ASYNC_QUEUE_SIZE) {
+			core_util_critical_section_exit();
+			return false;
+		}
+		tx_entry_t& w = _tx[(_tx_head + _tx_count) % UART_INTERFACE_ASYNC_QUEUE_SIZE];
+		w.buffer = buffer;
+		w.length = length;
+		w.sent = 0;
+		w.done = done;
+		_tx_count++;
+		ticket = ++_tx_queued;
+		start_tx();
+		core_util_critical_section_exit();
+		return true;
+	}
+
+	/**
+	 * Waits for a queued write to complete
+	 * Also restarts transmission, in case a BUSY release edge was missed
+	 */
+	void wait_tx_done(void) {
+		_tx_evt.wait_any(UART_INTERFACE_TX_DONE_FLAG, UART_INTERFACE_BUSY_POLL_MS);
+		core_util_critical_section_enter();
+		start_tx();
+		core_util_critical_section_exit();
+	}
+
+	/**
+	 * Attaches the TX interrupt if there is something to send
+	 * @note Must be called within a critical section (or interrupt context)
+	 */
+	void start_tx(void) {
+		if(!_tx_active && _tx_count && !is_busy()) {
+			_tx_active = true;
+			mbed::SerialBase::attach(mbed::callback(this, &UARTInterface::tx_irq), mbed::SerialBase::TxIrq);
+		}
+	}
+
+	/** Detaches the TX interrupt (interrupt context) */
+	void stop_tx(void) {
+		_tx_active = false;
+		mbed::SerialBase::attach(NULL, mbed::SerialBase::TxIrq);
 	}
 
+	/**
+	 * UART TX interrupt handler, sends bytes straight from the queued buffers
+	 */
+	void tx_irq(void) {
+		while(_tx_count) {
+			if(is_busy()) {
+				// busy_released() restarts transmission
+				stop_tx();
+				start_tx();
+				return;
+			}
+
+			tx_entry_t& w = _tx[_tx_head];
+			if(w.sent < w.length) {
+				if(!mbed::SerialBase::writeable()) {
+					return;
+				}
+				mbed::SerialBase::_base_putc(w.buffer[w.sent++]);
+			}
+
+			if(w.sent == w.length) {
+				mbed::Callback<void()> done = w.done;
+				_tx_head = (_tx_head + 1) % UART_INTERFACE_ASYNC_QUEUE_SIZE;
+				_tx_count--;
+				_tx_completed++;
+				_tx_evt.set(UART_INTERFACE_TX_DONE_FLAG);
+				if(done) {
+					done();
+				}
+			}
+
+			if(_busy) {
+				// Let the byte reach the module before BUSY is checked again
+				return;
+			}
+		}
+		stop_tx();
+	}
+
+	/** UART RX interrupt handler */
+	void rx_irq(void) {
+		while(mbed::SerialBase::readable()) {
+			_rx_buffer.push((uint8_t) mbed::SerialBase::_base_getc());
+		}
+		_rx_evt.set(UART_INTERFACE_RX_FLAG);
+		if(_rx_handler) {
+			_rx_handler();
+		}
+	}
+
+	/** BUSY release edge handler (interrupt context) */
+	void busy_released(void) {
+		start_tx();
+	}
+
+	/** BUSY input (optional) */
+	mbed::InterruptIn* _busy;
+
+	/** Logic level of the BUSY input when the module is busy */
+	const int _busy_level;
+
+	/** Current baud rate */
+	int _baud;
+
+	typedef struct {
+		const uint8_t* buffer;
+		uint32_t length;
+		uint32_t sent;
+		mbed::Callback<void()> done;
+	} tx_entry_t;
+
+	/** Queued writes, sent from the TX interrupt */
+	tx_entry_t _tx[UART_INTERFACE_ASYNC_QUEUE_SIZE];
+
+	volatile uint32_t _tx_head;
+
+	volatile uint32_t _tx_count;
+
+	/** Number of writes queued so far */
+	uint32_t _tx_queued;
+
+	/** Number of writes sent so far */
+	volatile uint32_t _tx_completed;
+
+	/** Set while the TX interrupt is attached */
+	volatile bool _tx_active;
+
+	/** TX done flag */
+	rtos::EventFlags _tx_evt;
+
+	/** Bytes received and not read yet */
+	mbed::CircularBuffer<uint8_t, UART_INTERFACE_RX_BUFFER_SIZE> _rx_buffer;
+
+	/** RX flag */
+	rtos::EventFlags _rx_evt;
+
+	/** RX event handler (optional) */
+	mbed::Callback<void()> _rx_handler;
+
 };
 
 #endif
@@ -0,0 +1,179 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "DisplayCommandQueue.h"
+
+#include <string.h>
+
+#include "platform/mbed_assert.h"
+#include "platform/mbed_critical.h"
+
+#define COMMAND_QUEUE_POSTED_FLAG 0x1
+
+#define COMMAND_QUEUE_MASK (DISPLAY_COMMAND_QUEUE_SIZE - 1)
+
+MBED_STATIC_ASSERT((DISPLAY_COMMAND_QUEUE_SIZE & COMMAND_QUEUE_MASK) == 0,
+		"DISPLAY_COMMAND_QUEUE_SIZE must be a power of 2");
+
+DisplayCommandQueue::DisplayCommandQueue(DisplayInterface& interface) :
+		_interface(interface), _enqueue_position(0), _dequeue_position(0),
+		_overflows(0), _posted_evt() {
+	for(uint32_t i = 0; i < DISPLAY_COMMAND_QUEUE_SIZE; i++) {
+		_cells[i].sequence = i;
+	}
+}
+
+bool DisplayCommandQueue::post(const uint8_t* buffer, uint32_t num_cmd_bytes, uint32_t buf_len) {
+	if(buf_len > DISPLAY_COMMAND_INLINE_SIZE) {
+		return false;
+	}
+
+	uint32_t position;
+	cell_t* cell = claim(position);
+	if(!cell) {
+		return false;
+	}
+
+	cell->command.type = COMMAND_INLINE;
+	cell->command.num_cmd_bytes = num_cmd_bytes;
+	cell->command.length = buf_len;
+	cell->command.buffer = NULL;
+	memcpy(cell->command.data, buffer, buf_len);
+	cell->command.operation = NULL;
+	cell->command.done = NULL;
+
+	publish(cell, position);
+	return true;
+}
+
+bool DisplayCommandQueue::post_buffer(const uint8_t* buffer, uint32_t num_cmd_bytes,
+		uint32_t buf_len, done_t done) {
+	uint32_t position;
+	cell_t* cell = claim(position);
+	if(!cell) {
+		return false;
+	}
+
+	cell->command.type = COMMAND_BUFFER;
+	cell->command.num_cmd_bytes = num_cmd_bytes;
+	cell->command.length = buf_len;
+	cell->command.buffer = buffer;
+	cell->command.operation = NULL;
+	cell->command.done = done;
+
+	publish(cell, position);
+	return true;
+}
+
+bool DisplayCommandQueue::post(operation_t operation, done_t done) {
+	uint32_t position;
+	cell_t* cell = claim(position);
+	if(!cell) {
+		return false;
+	}
+
+	cell->command.type = COMMAND_OPERATION;
+	cell->command.num_cmd_bytes = 0;
+	cell->command.length = 0;
+	cell->command.buffer = NULL;
+	cell->command.operation = operation;
+	cell->command.done = done;
+
+	publish(cell, position);
+	return true;
+}
+
+bool DisplayCommandQueue::dispatch_one(void) {
+	cell_t* cell = &_cells[_dequeue_position & COMMAND_QUEUE_MASK];
+
+	// Not published yet (empty, or a producer is still filling the cell)
+	if(core_util_atomic_load_u32(&cell->sequence) != (_dequeue_position + 1)) {
+		return false;
+	}
+
+	// Copy the command out so the cell can be reused while it executes
+	command_t command = cell->command;
+	core_util_atomic_store_u32(&cell->sequence, _dequeue_position + DISPLAY_COMMAND_QUEUE_SIZE);
+	_dequeue_position++;
+
+	switch(command.type) {
+		case COMMAND_INLINE:
+			_interface.write(command.data, command.num_cmd_bytes, command.length);
+			break;
+		case COMMAND_BUFFER:
+			_interface.write(command.buffer, command.num_cmd_bytes, command.length);
+			break;
+		case COMMAND_OPERATION:
+			command.operation(_interface);
+			break;
+	}
+
+	if(command.done) {
+		command.done();
+	}
+
+	return true;
+}
+
+uint32_t DisplayCommandQueue::dispatch(uint32_t timeout_ms) {
+	uint32_t executed = 0;
+	while(true) {
+		while(dispatch_one()) {
+			executed++;
+		}
+		if(executed) {
+			return executed;
+		}
+
+		uint32_t flags = _posted_evt.wait_any(COMMAND_QUEUE_POSTED_FLAG, timeout_ms);
+		if(flags & osFlagsError) {
+			return 0;
+		}
+	}
+}
+
+void DisplayCommandQueue::run(void) {
+	while(true) {
+		dispatch(osWaitForever);
+	}
+}
+
+DisplayCommandQueue::cell_t* DisplayCommandQueue::claim(uint32_t& position) {
+	position = core_util_atomic_load_u32(&_enqueue_position);
+	while(true) {
+		cell_t* cell = &_cells[position & COMMAND_QUEUE_MASK];
+		int32_t diff = (int32_t) (core_util_atomic_load_u32(&cell->sequence) - position);
+		if(diff == 0) {
+			// Cell is free, try to claim it (on failure position is reloaded)
+			if(core_util_atomic_cas_u32(&_enqueue_position, &position, position + 1)) {
+				return cell;
+			}
+		} else if(diff < 0) {
+			// Consumer has not released this cell yet, the queue is full
+			core_util_atomic_incr_u32(&_overflows, 1);
+			return NULL;
+		} else {
+			// Another producer claimed it first
+			position = core_util_atomic_load_u32(&_enqueue_position);
+		}
+	}
+}
+
+void DisplayCommandQueue::publish(cell_t* cell, uint32_t position) {
+	core_util_atomic_store_u32(&cell->sequence, position + 1);
+	_posted_evt.set(COMMAND_QUEUE_POSTED_FLAG);
+}
@@ -0,0 +1,178 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UDISPLAY_PLATFORM_DISPLAYCOMMANDQUEUE_H_
+#define UDISPLAY_PLATFORM_DISPLAYCOMMANDQUEUE_H_
+
+#include "DisplayInterface.h"
+
+#include "platform/Callback.h"
+#include "rtos/EventFlags.h"
+
+/** Number of commands the queue can hold (must be a power of 2) */
+#ifndef DISPLAY_COMMAND_QUEUE_SIZE
+#define DISPLAY_COMMAND_QUEUE_SIZE 16
+#endif
+
+/** Largest transaction that is copied into the queue by post() */
+#ifndef DISPLAY_COMMAND_INLINE_SIZE
+#define DISPLAY_COMMAND_INLINE_SIZE 16
+#endif
+
+/**
+ * Lock-free multi-producer, single-consumer display command queue
+ *
+ * Producers (threads or ISRs) enqueue complete, self-contained commands.
+ * A single consumer thread owns the DisplayInterface and executes each
+ * command in full before starting the next one, so commands are never
+ * interleaved on the wire and producers never contend on a mutex.
+ *
+ * Three kinds of commands can be queued:
+ * - small transactions, copied into the queue (eg: VFD text, register writes)
+ * - caller-owned buffers (eg: pixel data), with an optional completion callback
+ * - operations executed by the consumer against the interface
+ *   (eg: a window write made of several transactions)
+ *
+ * The queue is a bounded ring where each cell carries a sequence number;
+ * producers claim cells with a compare-and-swap on the enqueue position.
+ */
+class DisplayCommandQueue
+{
+	public:
+
+		/** Operation executed by the consumer against the interface */
+		typedef mbed::Callback<void(DisplayInterface&)> operation_t;
+
+		/** Completion callback, executed by the consumer */
+		typedef mbed::Callback<void()> done_t;
+
+		/**
+		 * Instantiate a command queue
+		 * @param[in] interface Display interface owned by the consumer
+		 */
+		DisplayCommandQueue(DisplayInterface& interface);
+
+		virtual ~DisplayCommandQueue(void) { }
+
+		/**
+		 * Queues a small transaction, copying it into the queue
+		 * @note ISR safe
+		 * @param[in] buffer Transaction bytes
+		 * @param[in] num_cmd_bytes Number of command bytes at beginning of buffer
+		 * @param[in] buf_len Total number of bytes (at most DISPLAY_COMMAND_INLINE_SIZE)
+		 * @retval true if queued, false if the queue is full or the transaction is too long
+		 */
+		bool post(const uint8_t* buffer, uint32_t num_cmd_bytes, uint32_t buf_len);
+
+		/**
+		 * Queues a caller-owned buffer
+		 * @note ISR safe
+		 * @param[in] buffer Transaction bytes, must remain valid until done is called
+		 * @param[in] num_cmd_bytes Number of command bytes at beginning of buffer
+		 * @param[in] buf_len Total number of bytes
+		 * @param[in] done (optional) Executed by the consumer once the buffer is written
+		 * @retval true if queued, false if the queue is full
+		 */
+		bool post_buffer(const uint8_t* buffer, uint32_t num_cmd_bytes, uint32_t buf_len,
+				done_t done = NULL);
+
+		/**
+		 * Queues an operation executed by the consumer against the interface
+		 * @note ISR safe
+		 * @param[in] operation Operation to execute
+		 * @param[in] done (optional) Executed by the consumer once the operation completes
+		 * @retval true if queued, false if the queue is full
+		 */
+		bool post(operation_t operation, done_t done = NULL);
+
+		/**
+		 * Executes the oldest queued command
+		 * @note Must only be called from the consumer thread
+		 * @retval true if a command was executed, false if the queue was empty
+		 */
+		bool dispatch_one(void);
+
+		/**
+		 * Executes queued commands, waiting for more if the queue is empty
+		 * @note Must only be called from the consumer thread
+		 * @param[in] timeout_ms Maximum time to wait for a command
+		 * @retval number of commands executed
+		 */
+		uint32_t dispatch(uint32_t timeout_ms = osWaitForever);
+
+		/**
+		 * Consumer thread main loop, executes commands forever
+		 */
+		void run(void);
+
+		/**
+		 * Gets the number of commands rejected because the queue was full
+		 */
+		uint32_t overflows(void) const {
+			return _overflows;
+		}
+
+	private:
+
+		typedef enum {
+			COMMAND_INLINE,
+			COMMAND_BUFFER,
+			COMMAND_OPERATION
+		} command_type_t;
+
+		typedef struct {
+			command_type_t type;
+			uint32_t num_cmd_bytes;
+			uint32_t length;
+			const uint8_t* buffer;
+			uint8_t data[DISPLAY_COMMAND_INLINE_SIZE];
+			operation_t operation;
+			done_t done;
+		} command_t;
+
+		typedef struct {
+			/** Cell is free for position N when sequence == N, ready when sequence == N + 1 */
+			volatile uint32_t sequence;
+			command_t command;
+		} cell_t;
+
+		/**
+		 * Claims a cell for a producer
+		 * @retval claimed cell, or NULL if the queue is full
+		 */
+		cell_t* claim(uint32_t& position);
+
+		/** Publishes a filled cell to the consumer */
+		void publish(cell_t* cell, uint32_t position);
+
+		DisplayInterface& _interface;
+
+		cell_t _cells[DISPLAY_COMMAND_QUEUE_SIZE];
+
+		/** Next position producers enqueue at */
+		volatile uint32_t _enqueue_position;
+
+		/** Next position the consumer dequeues from (consumer only) */
+		uint32_t _dequeue_position;
+
+		volatile uint32_t _overflows;
+
+		rtos::EventFlags _posted_evt;
+
+};
+
+#endif /* UDISPLAY_PLATFORM_DISPLAYCOMMANDQUEUE_H_ */
@@ -0,0 +1,253 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "DisplayList.h"
+#include "MIPIDCS.h"
+
+#include <string.h>
+
+/** Window payload: CASET + 4 params, RASET + 4 params, RAMWR */
+#define WINDOW_PAYLOAD_SIZE 11
+
+/** Operations are kept 4-byte aligned in the arena */
+#define ALIGN4(x) (((x) + 3) & ~3UL)
+
+DisplayList::DisplayList(uint8_t* arena, uint32_t size) : _arena(arena), _size(size),
+		_used(0), _overflowed(false), _staged_cmd_bytes(0), _staged_length(0),
+		_last_transactions(0) {
+}
+
+void DisplayList::clear(void) {
+	_used = 0;
+	_overflowed = false;
+}
+
+DisplayList::handle_t DisplayList::command(uint8_t cmd, const uint8_t* params, uint32_t len) {
+	handle_t handle = append(OP_INLINE, 1, len + 1, len + 1);
+	if(handle != DISPLAY_LIST_INVALID_HANDLE) {
+		uint8_t* bytes = payload(handle);
+		bytes[0] = cmd;
+		if(len) {
+			memcpy(&bytes[1], params, len);
+		}
+	}
+	return handle;
+}
+
+DisplayList::handle_t DisplayList::data(const uint8_t* data, uint32_t len) {
+	handle_t handle = append(OP_INLINE, 0, len, len);
+	if(handle != DISPLAY_LIST_INVALID_HANDLE) {
+		memcpy(payload(handle), data, len);
+	}
+	return handle;
+}
+
+DisplayList::handle_t DisplayList::blit(const uint8_t* data, uint32_t len) {
+	handle_t handle = append(OP_REFERENCE, 0, len, sizeof(const uint8_t*));
+	if(handle != DISPLAY_LIST_INVALID_HANDLE) {
+		memcpy(payload(handle), &data, sizeof(const uint8_t*));
+	}
+	return handle;
+}
+
+DisplayList::handle_t DisplayList::fill(const uint8_t* pattern, uint32_t pattern_len,
+		uint32_t count) {
+	if(pattern_len == 0 || pattern_len > DISPLAY_LIST_MAX_PATTERN) {
+		return DISPLAY_LIST_INVALID_HANDLE;
+	}
+	handle_t handle = append(OP_FILL, 0, pattern_len * count, pattern_len);
+	if(handle != DISPLAY_LIST_INVALID_HANDLE) {
+		memcpy(payload(handle), pattern, pattern_len);
+	}
+	return handle;
+}
+
+DisplayList::handle_t DisplayList::set_window(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1) {
+	handle_t handle = append(OP_WINDOW, 1, WINDOW_PAYLOAD_SIZE, WINDOW_PAYLOAD_SIZE);
+	if(handle != DISPLAY_LIST_INVALID_HANDLE) {
+		encode_window(handle, x0, y0, x1, y1);
+	}
+	return handle;
+}
+
+bool DisplayList::patch(handle_t handle, uint32_t offset, const uint8_t* bytes, uint32_t len) {
+	op_header_t* op = header(handle);
+	if(!op || (op->type != OP_INLINE && op->type != OP_FILL) || (offset + len) > op->size) {
+		return false;
+	}
+	memcpy(payload(handle) + offset, bytes, len);
+	return true;
+}
+
+bool DisplayList::patch_blit(handle_t handle, const uint8_t* data, uint32_t len) {
+	op_header_t* op = header(handle);
+	if(!op || op->type != OP_REFERENCE) {
+		return false;
+	}
+	memcpy(payload(handle), &data, sizeof(const uint8_t*));
+	op->length = len;
+	return true;
+}
+
+bool DisplayList::patch_window(handle_t handle, uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1) {
+	op_header_t* op = header(handle);
+	if(!op || op->type != OP_WINDOW) {
+		return false;
+	}
+	encode_window(handle, x0, y0, x1, y1);
+	return true;
+}
+
+void DisplayList::execute(DisplayInterface& interface) {
+	_staged_length = 0;
+	_staged_cmd_bytes = 0;
+	_last_transactions = 0;
+
+	handle_t handle = 0;
+	while(handle < _used) {
+		op_header_t* op = header(handle);
+		uint8_t* bytes = payload(handle);
+
+		switch(op->type) {
+			case OP_INLINE:
+				stage(interface, bytes, op->num_cmd_bytes, op->length);
+				break;
+			case OP_REFERENCE: {
+				const uint8_t* data;
+				memcpy(&data, bytes, sizeof(const uint8_t*));
+				stage(interface, data, 0, op->length);
+				break;
+			}
+			case OP_FILL:
+				write_fill(interface, bytes, op->size, op->length);
+				break;
+			case OP_WINDOW:
+				stage(interface, &bytes[0], 1, 5);
+				stage(interface, &bytes[5], 1, 5);
+				stage(interface, &bytes[10], 1, 1);
+				break;
+		}
+
+		handle += ALIGN4(sizeof(op_header_t) + op->size);
+	}
+
+	flush(interface);
+}
+
+bool DisplayList::submit(DisplayCommandQueue& queue, DisplayCommandQueue::done_t done) {
+	return queue.post(mbed::callback(this, &DisplayList::execute), done);
+}
+
+DisplayList::handle_t DisplayList::append(op_type_t type, uint32_t num_cmd_bytes,
+		uint32_t length, uint32_t size) {
+	uint32_t footprint = ALIGN4(sizeof(op_header_t) + size);
+	if(size > 0xFFFF || (_used + footprint) > _size) {
+		_overflowed = true;
+		return DISPLAY_LIST_INVALID_HANDLE;
+	}
+
+	handle_t handle = _used;
+	op_header_t* op = (op_header_t*) &_arena[handle];
+	op->type = type;
+	op->num_cmd_bytes = num_cmd_bytes;
+	op->size = size;
+	op->length = length;
+	_used += footprint;
+	return handle;
+}
+
+DisplayList::op_header_t* DisplayList::header(handle_t handle) {
+	if(handle >= _used || (handle & 3)) {
+		return NULL;
+	}
+	return (op_header_t*) &_arena[handle];
+}
+
+void DisplayList::encode_window(handle_t handle, uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1) {
+	uint8_t* bytes = payload(handle);
+	bytes[0] = MIPI_DCS_SET_COLUMN_ADDRESS;
+	bytes[1] = (x0 >> 8);
+	bytes[2] = (x0 & 0xFF);
+	bytes[3] = (x1 >> 8);
+	bytes[4] = (x1 & 0xFF);
+	bytes[5] = MIPI_DCS_SET_PAGE_ADDRESS;
+	bytes[6] = (y0 >> 8);
+	bytes[7] = (y0 & 0xFF);
+	bytes[8] = (y1 >> 8);
+	bytes[9] = (y1 & 0xFF);
+	bytes[10] = MIPI_DCS_WRITE_MEMORY_START;
+}
+
+void DisplayList::stage(DisplayInterface& interface, const uint8_t* bytes,
+		uint32_t num_cmd_bytes, uint32_t length) {
+
+	// Commands must come first in a transaction, data can be appended to anything
+	bool mergeable = (num_cmd_bytes == 0) || (_staged_length == 0);
+	if(!mergeable || (_staged_length + length) > DISPLAY_LIST_STAGING_SIZE) {
+		flush(interface);
+	}
+
+	// Too big to coalesce, send it straight from where it is
+	if(length > DISPLAY_LIST_STAGING_SIZE) {
+		interface.write(bytes, num_cmd_bytes, length);
+		_last_transactions++;
+		return;
+	}
+
+	if(_staged_length == 0) {
+		_staged_cmd_bytes = num_cmd_bytes;
+	}
+	memcpy(&_staging[_staged_length], bytes, length);
+	_staged_length += length;
+}
+
+void DisplayList::flush(DisplayInterface& interface) {
+	if(_staged_length == 0) {
+		return;
+	}
+	interface.write(_staging, _staged_cmd_bytes, _staged_length);
+	_last_transactions++;
+	_staged_length = 0;
+	_staged_cmd_bytes = 0;
+}
+
+void DisplayList::write_fill(DisplayInterface& interface, const uint8_t* pattern, uint32_t pattern_len,
+		uint32_t length) {
+	// Expand the pattern into as many whole patterns as the fill needs (or fit)
+	uint32_t per_block = (sizeof(_fill) / pattern_len) * pattern_len;
+	if(length < per_block) {
+		per_block = length;
+	}
+	for(uint32_t i = 0; i < per_block; i += pattern_len) {
+		memcpy(&_fill[i], pattern, pattern_len);
+	}
+
+	// Small fills are coalesced like any other operation
+	if(length <= DISPLAY_LIST_STAGING_SIZE) {
+		stage(interface, _fill, 0, length);
+		return;
+	}
+
+	flush(interface);
+	uint32_t remaining = length;
+	while(remaining) {
+		uint32_t len = (remaining < per_block) ? remaining : per_block;
+		interface.write(_fill, 0, len);
+		_last_transactions++;
+		remaining -= len;
+	}
+}
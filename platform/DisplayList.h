@@ -0,0 +1,248 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UDISPLAY_PLATFORM_DISPLAYLIST_H_
+#define UDISPLAY_PLATFORM_DISPLAYLIST_H_
+
+#include "DisplayInterface.h"
+#include "DisplayCommandQueue.h"
+
+/** Size of the buffer small operations are coalesced into when a list executes */
+#ifndef DISPLAY_LIST_STAGING_SIZE
+#define DISPLAY_LIST_STAGING_SIZE 64
+#endif
+
+/**
+ * Size of the buffer fill patterns are expanded into when a list executes.
+ * Large fills are sent as one transaction per filled buffer.
+ */
+#ifndef DISPLAY_LIST_FILL_BUFFER_SIZE
+#define DISPLAY_LIST_FILL_BUFFER_SIZE 512
+#endif
+
+/** Largest fill pattern (eg: one pixel) */
+#define DISPLAY_LIST_MAX_PATTERN 4
+
+/** Returned when an operation does not fit in the list's arena */
+#define DISPLAY_LIST_INVALID_HANDLE 0xFFFFFFFF
+
+/**
+ * Display list
+ *
+ * Records a sequence of display operations (commands, address windows,
+ * blits, fills, text/VFD bytes) into a caller-provided arena without
+ * touching the bus. A recorded list can be executed any number of times,
+ * either directly or in the background through a DisplayCommandQueue, so
+ * UI logic timing is decoupled from bus timing and frames are reproducible.
+ *
+ * Each recording call returns a handle that can be used to patch the
+ * operation later (eg: re-point a blit at different glyphs) without
+ * recording the list again.
+ *
+ * When executed, adjacent small operations are coalesced into as few
+ * interface transactions as possible.
+ *
+ * @note A list must not be modified while it is being executed
+ */
+class DisplayList
+{
+	public:
+
+		typedef uint32_t handle_t;
+
+		/**
+		 * Instantiate a display list
+		 * @param[in] arena Memory operations are recorded into
+		 * @param[in] size Size of the arena
+		 */
+		DisplayList(uint8_t* arena, uint32_t size);
+
+		virtual ~DisplayList(void) { }
+
+		/**
+		 * Discards every recorded operation
+		 */
+		void clear(void);
+
+		/**
+		 * Records a command with optional parameters
+		 * @param[in] cmd Command byte
+		 * @param[in] params (optional) Parameter bytes, copied into the list
+		 * @param[in] len Number of parameter bytes
+		 * @retval handle to the operation, or DISPLAY_LIST_INVALID_HANDLE if the arena is full
+		 */
+		handle_t command(uint8_t cmd, const uint8_t* params = NULL, uint32_t len = 0);
+
+		/**
+		 * Records data bytes copied into the list (eg: VFD text or commands)
+		 * @param[in] data Bytes to send
+		 * @param[in] len Number of bytes
+		 * @retval handle to the operation, or DISPLAY_LIST_INVALID_HANDLE if the arena is full
+		 */
+		handle_t data(const uint8_t* data, uint32_t len);
+
+		/**
+		 * Records data sent from a caller-owned buffer (eg: pixels or glyphs)
+		 * @param[in] data Bytes to send, must remain valid while the list is used
+		 * @param[in] len Number of bytes
+		 * @retval handle to the operation, or DISPLAY_LIST_INVALID_HANDLE if the arena is full
+		 */
+		handle_t blit(const uint8_t* data, uint32_t len);
+
+		/**
+		 * Records a pattern repeated a number of times (eg: a solid color)
+		 * @param[in] pattern Pattern bytes (at most DISPLAY_LIST_MAX_PATTERN)
+		 * @param[in] pattern_len Number of pattern bytes
+		 * @param[in] count Number of times the pattern is repeated
+		 * @retval handle to the operation, or DISPLAY_LIST_INVALID_HANDLE if the arena is full
+		 */
+		handle_t fill(const uint8_t* pattern, uint32_t pattern_len, uint32_t count);
+
+		/**
+		 * Records a MIPI DCS address window followed by a memory write command
+		 * @param[in] x0 First column
+		 * @param[in] y0 First row
+		 * @param[in] x1 Last column
+		 * @param[in] y1 Last row
+		 * @retval handle to the window, or DISPLAY_LIST_INVALID_HANDLE if the arena is full
+		 */
+		handle_t set_window(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1);
+
+		/**
+		 * Overwrites bytes of a recorded command or data operation
+		 * @param[in] handle Operation to patch
+		 * @param[in] offset Offset of the first byte to overwrite (a command's parameters start at 1)
+		 * @param[in] bytes New bytes
+		 * @param[in] len Number of bytes
+		 * @retval true if patched, false if the operation has no such bytes
+		 */
+		bool patch(handle_t handle, uint32_t offset, const uint8_t* bytes, uint32_t len);
+
+		/**
+		 * Re-points a recorded blit at another buffer
+		 * @param[in] handle Blit to patch
+		 * @param[in] data New buffer
+		 * @param[in] len Number of bytes
+		 * @retval true if patched, false if the operation is not a blit
+		 */
+		bool patch_blit(handle_t handle, const uint8_t* data, uint32_t len);
+
+		/**
+		 * Moves a recorded address window
+		 * @param[in] handle Window returned by set_window()
+		 * @retval true if patched, false if the operation is not a window
+		 */
+		bool patch_window(handle_t handle, uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1);
+
+		/**
+		 * Executes the list
+		 * @param[in] interface Interface to execute the list on
+		 */
+		void execute(DisplayInterface& interface);
+
+		/**
+		 * Submits the list for execution by a command queue's consumer
+		 * @param[in] queue Queue to submit the list to
+		 * @param[in] done (optional) Executed once the list has been executed
+		 * @retval true if submitted, false if the queue is full
+		 */
+		bool submit(DisplayCommandQueue& queue, DisplayCommandQueue::done_t done = NULL);
+
+		/**
+		 * Gets the number of arena bytes used
+		 */
+		uint32_t used(void) const {
+			return _used;
+		}
+
+		/**
+		 * Checks if an operation was dropped because the arena was full
+		 */
+		bool overflowed(void) const {
+			return _overflowed;
+		}
+
+		/**
+		 * Gets the number of interface transactions the last execution took
+		 */
+		uint32_t last_transactions(void) const {
+			return _last_transactions;
+		}
+
+	private:
+
+		typedef enum {
+			OP_INLINE,		/** Bytes stored in the arena */
+			OP_REFERENCE,	/** Bytes in a caller-owned buffer */
+			OP_FILL,		/** Repeated pattern */
+			OP_WINDOW		/** Address window (CASET + RASET + RAMWR) */
+		} op_type_t;
+
+		typedef struct {
+			uint8_t type;
+			uint8_t num_cmd_bytes;
+			uint16_t size;		/** Size of the payload stored in the arena */
+			uint32_t length;	/** Number of bytes sent */
+		} op_header_t;
+
+		/** Reserves space for an operation, returns its handle */
+		handle_t append(op_type_t type, uint32_t num_cmd_bytes, uint32_t length, uint32_t size);
+
+		/** Gets an operation's header, NULL if the handle is invalid */
+		op_header_t* header(handle_t handle);
+
+		/** Gets an operation's payload */
+		uint8_t* payload(handle_t handle) {
+			return &_arena[handle + sizeof(op_header_t)];
+		}
+
+		/** Fills in the payload of a window operation */
+		void encode_window(handle_t handle, uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1);
+
+		/** Appends bytes to the staging buffer, flushing it when needed */
+		void stage(DisplayInterface& interface, const uint8_t* bytes, uint32_t num_cmd_bytes,
+				uint32_t length);
+
+		/** Writes out the staging buffer */
+		void flush(DisplayInterface& interface);
+
+		/** Writes out a fill operation */
+		void write_fill(DisplayInterface& interface, const uint8_t* pattern, uint32_t pattern_len,
+				uint32_t length);
+
+		uint8_t* _arena;
+
+		uint32_t _size;
+
+		uint32_t _used;
+
+		bool _overflowed;
+
+		uint8_t _staging[DISPLAY_LIST_STAGING_SIZE];
+
+		uint32_t _staged_cmd_bytes;
+
+		uint32_t _staged_length;
+
+		/** Fill patterns are expanded into this buffer */
+		uint8_t _fill[DISPLAY_LIST_FILL_BUFFER_SIZE];
+
+		uint32_t _last_transactions;
+
+};
+
+#endif /* UDISPLAY_PLATFORM_DISPLAYLIST_H_ */
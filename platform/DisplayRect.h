@@ -0,0 +1,33 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UDISPLAY_PLATFORM_DISPLAYRECT_H_
+#define UDISPLAY_PLATFORM_DISPLAYRECT_H_
+
+#include <stdint.h>
+
+/**
+ * Rectangular display region (inclusive coordinates)
+ */
+typedef struct {
+	uint16_t x0;
+	uint16_t y0;
+	uint16_t x1;
+	uint16_t y1;
+} display_rect_t;
+
+#endif /* UDISPLAY_PLATFORM_DISPLAYRECT_H_ */
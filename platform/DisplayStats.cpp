@@ -0,0 +1,116 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "DisplayStats.h"
+
+#include "platform/mbed_critical.h"
+
+#if UDISPLAY_STATS_TIMING
+
+#include "hal/us_ticker_api.h"
+
+/** Width of a single throughput window bucket */
+#define STATS_BUCKET_US ((UDISPLAY_STATS_WINDOW_MS * 1000UL) / UDISPLAY_STATS_WINDOW_BUCKETS)
+
+uint32_t DisplayStats::now(void) {
+	return us_ticker_read();
+}
+
+void DisplayStats::record_blocked(uint32_t start_us) {
+	uint32_t elapsed = now() - start_us;
+	core_util_critical_section_enter();
+	_stats.blocked_us += elapsed;
+	core_util_critical_section_exit();
+}
+
+#endif
+
+void DisplayStats::record_transaction(uint32_t num_cmd_bytes, uint32_t buf_len,
+		uint32_t cs_assertions) {
+#if UDISPLAY_STATS_TIMING
+	uint32_t now_us = now();
+#endif
+	core_util_critical_section_enter();
+	_stats.cmd_bytes += num_cmd_bytes;
+	_stats.data_bytes += (buf_len - num_cmd_bytes);
+	_stats.transactions++;
+	_stats.cs_assertions += cs_assertions;
+#if UDISPLAY_STATS_TIMING
+	advance_window(now_us);
+	_window[_window_tick % UDISPLAY_STATS_WINDOW_BUCKETS] += buf_len;
+#endif
+	core_util_critical_section_exit();
+}
+
+void DisplayStats::record_queue_depth(uint32_t depth) {
+	core_util_critical_section_enter();
+	_stats.queue_depth = depth;
+	if(depth > _stats.peak_queue_depth) {
+		_stats.peak_queue_depth = depth;
+	}
+	core_util_critical_section_exit();
+}
+
+void DisplayStats::snapshot(display_stats_t& stats) {
+#if UDISPLAY_STATS_TIMING
+	uint32_t now_us = now();
+	uint32_t window_bytes = 0;
+	core_util_critical_section_enter();
+	advance_window(now_us);
+	for(int i = 0; i < UDISPLAY_STATS_WINDOW_BUCKETS; i++) {
+		window_bytes += _window[i];
+	}
+	stats = _stats;
+	core_util_critical_section_exit();
+
+	stats.bytes_per_second = (uint32_t)(((uint64_t) window_bytes * 1000) / UDISPLAY_STATS_WINDOW_MS);
+#else
+	core_util_critical_section_enter();
+	stats = _stats;
+	core_util_critical_section_exit();
+#endif
+}
+
+void DisplayStats::reset(void) {
+	core_util_critical_section_enter();
+	memset(&_stats, 0, sizeof(_stats));
+#if UDISPLAY_STATS_TIMING
+	memset(_window, 0, sizeof(_window));
+#endif
+	core_util_critical_section_exit();
+}
+
+#if UDISPLAY_STATS_TIMING
+
+void DisplayStats::advance_window(uint32_t now_us) {
+	uint32_t tick = now_us / STATS_BUCKET_US;
+	uint32_t elapsed = tick - _window_tick;
+	if(elapsed == 0) {
+		return;
+	}
+
+	// Clear the buckets that were skipped over (all of them if the window expired)
+	if(elapsed > UDISPLAY_STATS_WINDOW_BUCKETS) {
+		elapsed = UDISPLAY_STATS_WINDOW_BUCKETS;
+	}
+	for(uint32_t i = 1; i <= elapsed; i++) {
+		_window[(_window_tick + i) % UDISPLAY_STATS_WINDOW_BUCKETS] = 0;
+	}
+	_window_tick = tick;
+}
+
+#endif /* UDISPLAY_STATS_TIMING */
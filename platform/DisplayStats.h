@@ -0,0 +1,146 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UDISPLAY_PLATFORM_DISPLAYSTATS_H_
+#define UDISPLAY_PLATFORM_DISPLAYSTATS_H_
+
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Set to 1 (eg: in the "macros" section of mbed_app.json) to also measure
+ * time: time blocked on the bus and throughput over a sliding window.
+ * When 0, no timestamps are taken and those counters read zero; the byte,
+ * transaction and queue depth counters are always kept.
+ */
+#ifndef UDISPLAY_STATS_TIMING
+#define UDISPLAY_STATS_TIMING 0
+#endif
+
+/** Length of the sliding window used to compute throughput */
+#ifndef UDISPLAY_STATS_WINDOW_MS
+#define UDISPLAY_STATS_WINDOW_MS 1000
+#endif
+
+/** Number of buckets the throughput window is divided into */
+#ifndef UDISPLAY_STATS_WINDOW_BUCKETS
+#define UDISPLAY_STATS_WINDOW_BUCKETS 8
+#endif
+
+/**
+ * Snapshot of a DisplayInterface's performance counters
+ */
+typedef struct {
+	uint64_t cmd_bytes;				/** Command bytes transmitted */
+	uint64_t data_bytes;			/** Data bytes transmitted */
+	uint32_t transactions;			/** Number of transactions (write calls) */
+	uint32_t cs_assertions;			/** Number of times chip select was asserted */
+	uint64_t blocked_us;			/** Time callers spent blocked waiting on the bus (UDISPLAY_STATS_TIMING) */
+	uint32_t bytes_per_second;		/** Throughput over the last UDISPLAY_STATS_WINDOW_MS (UDISPLAY_STATS_TIMING) */
+	uint32_t queue_depth;			/** Current number of queued/in-flight transfers */
+	uint32_t peak_queue_depth;		/** Highest queue depth seen */
+} display_stats_t;
+
+/**
+ * Performance counters kept by every DisplayInterface
+ *
+ * Updates are done inside a critical section so they may be made from
+ * interrupt context and snapshots are always consistent.
+ */
+class DisplayStats
+{
+	public:
+
+		DisplayStats(void) {
+			memset(&_stats, 0, sizeof(_stats));
+#if UDISPLAY_STATS_TIMING
+			memset(_window, 0, sizeof(_window));
+			_window_tick = 0;
+#endif
+		}
+
+#if UDISPLAY_STATS_TIMING
+
+		/**
+		 * Gets the current time used for blocked-time measurements
+		 * @retval current time in microseconds
+		 */
+		static uint32_t now(void);
+
+		/**
+		 * Records time a caller spent blocked on the bus
+		 * @param[in] start_us Timestamp (from now()) taken when blocking began
+		 */
+		void record_blocked(uint32_t start_us);
+
+#else
+
+		static uint32_t now(void) { return 0; }
+
+		void record_blocked(uint32_t start_us) { }
+
+#endif
+
+		/**
+		 * Records a completed transaction
+		 * @param[in] num_cmd_bytes Number of command bytes in the transaction
+		 * @param[in] buf_len Total number of bytes in the transaction
+		 * @param[in] cs_assertions Number of chip select assertions it took
+		 */
+		void record_transaction(uint32_t num_cmd_bytes, uint32_t buf_len,
+				uint32_t cs_assertions = 1);
+
+		/**
+		 * Records the current number of queued/in-flight transfers
+		 * @param[in] depth Current queue depth
+		 */
+		void record_queue_depth(uint32_t depth);
+
+		/**
+		 * Copies the counters out
+		 * @param[out] stats Snapshot to fill
+		 */
+		void snapshot(display_stats_t& stats);
+
+		/**
+		 * Resets all counters to zero
+		 */
+		void reset(void);
+
+	private:
+
+		display_stats_t _stats;
+
+#if UDISPLAY_STATS_TIMING
+
+		/**
+		 * Advances the throughput window to the current time
+		 * @note Must be called within a critical section
+		 */
+		void advance_window(uint32_t now_us);
+
+		/** Bytes transmitted in each bucket of the throughput window */
+		uint32_t _window[UDISPLAY_STATS_WINDOW_BUCKETS];
+
+		/** Index of the bucket (in bucket-sized time units) being filled */
+		uint32_t _window_tick;
+
+#endif
+
+};
+
+#endif /* UDISPLAY_PLATFORM_DISPLAYSTATS_H_ */
@@ -0,0 +1,138 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "DisplayTrace.h"
+
+#if UDISPLAY_TRACE_ENABLED
+
+#include "platform/mbed_assert.h"
+#include "platform/mbed_critical.h"
+
+MBED_STATIC_ASSERT((UDISPLAY_TRACE_BUFFER_SIZE & (UDISPLAY_TRACE_BUFFER_SIZE - 1)) == 0,
+		"UDISPLAY_TRACE_BUFFER_SIZE must be a power of 2");
+
+#define TRACE_INDEX_MASK (UDISPLAY_TRACE_BUFFER_SIZE - 1)
+
+display_trace_record_t DisplayTrace::_records[UDISPLAY_TRACE_BUFFER_SIZE];
+volatile uint32_t DisplayTrace::_head = 0;
+
+void DisplayTrace::log(const void* source, uint32_t start_us, uint8_t command,
+		uint32_t num_cmd_bytes, uint32_t length) {
+
+	uint32_t end_us = now();
+
+	// Reserve a slot, the returned value is the new head (1-based sequence)
+	uint32_t sequence = core_util_atomic_incr_u32(&_head, 1);
+	volatile display_trace_record_t* record = &_records[(sequence - 1) & TRACE_INDEX_MASK];
+
+	// Invalidate the slot while it is being filled in so readers skip it
+	record->sequence = 0;
+	record->timestamp_us = start_us;
+	record->duration_us = end_us - start_us;
+	record->length = length;
+	record->source = (uint32_t)(uintptr_t) source;
+	record->num_cmd_bytes = (uint16_t) num_cmd_bytes;
+	record->command = command;
+	record->flags = (num_cmd_bytes ? DISPLAY_TRACE_FLAG_HAS_COMMAND : 0);
+	record->sequence = sequence;
+}
+
+uint32_t DisplayTrace::snapshot(display_trace_record_t* records, uint32_t max_records) {
+
+	uint32_t head = core_util_atomic_load_u32(&_head);
+	uint32_t first = (head > UDISPLAY_TRACE_BUFFER_SIZE) ? (head - UDISPLAY_TRACE_BUFFER_SIZE) : 0;
+	uint32_t count = 0;
+
+	for(uint32_t i = first; i < head && count < max_records; i++) {
+		volatile display_trace_record_t* record = &_records[i & TRACE_INDEX_MASK];
+		uint32_t sequence = record->sequence;
+		if(sequence != (i + 1)) {
+			// Slot is being written or was overwritten by a newer record
+			continue;
+		}
+
+		display_trace_record_t* out = &records[count];
+		out->timestamp_us = record->timestamp_us;
+		out->duration_us = record->duration_us;
+		out->length = record->length;
+		out->source = record->source;
+		out->num_cmd_bytes = record->num_cmd_bytes;
+		out->command = record->command;
+		out->flags = record->flags;
+		out->sequence = sequence;
+
+		// Make sure the record wasn't overwritten while it was copied
+		if(record->sequence == sequence) {
+			count++;
+		}
+	}
+
+	return count;
+}
+
+void DisplayTrace::dump(FILE* stream) {
+
+	display_trace_record_t record;
+	uint32_t head = core_util_atomic_load_u32(&_head);
+	uint32_t first = (head > UDISPLAY_TRACE_BUFFER_SIZE) ? (head - UDISPLAY_TRACE_BUFFER_SIZE) : 0;
+
+	fprintf(stream, "udt-begin,%lu\r\n", (unsigned long) (head - first));
+
+	// Records are copied out one at a time to avoid a large stack buffer
+	for(uint32_t i = first; i < head; i++) {
+		volatile display_trace_record_t* slot = &_records[i & TRACE_INDEX_MASK];
+		if(slot->sequence != (i + 1)) {
+			continue;
+		}
+
+		record.timestamp_us = slot->timestamp_us;
+		record.duration_us = slot->duration_us;
+		record.length = slot->length;
+		record.source = slot->source;
+		record.num_cmd_bytes = slot->num_cmd_bytes;
+		record.command = slot->command;
+		record.flags = slot->flags;
+
+		if(slot->sequence != (i + 1)) {
+			continue;
+		}
+
+		// udt,<sequence>,<timestamp us>,<duration us>,<source>,<flags>,<command>,<cmd bytes>,<length>
+		fprintf(stream, "udt,%lu,%lu,%lu,%08lx,%02x,%02x,%u,%lu\r\n",
+				(unsigned long) (i + 1),
+				(unsigned long) record.timestamp_us,
+				(unsigned long) record.duration_us,
+				(unsigned long) record.source,
+				record.flags,
+				record.command,
+				record.num_cmd_bytes,
+				(unsigned long) record.length);
+	}
+
+	fprintf(stream, "udt-end\r\n");
+}
+
+void DisplayTrace::clear(void) {
+	core_util_critical_section_enter();
+	for(uint32_t i = 0; i < UDISPLAY_TRACE_BUFFER_SIZE; i++) {
+		_records[i].sequence = 0;
+	}
+	_head = 0;
+	core_util_critical_section_exit();
+}
+
+#endif /* UDISPLAY_TRACE_ENABLED */
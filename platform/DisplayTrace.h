@@ -0,0 +1,137 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UDISPLAY_PLATFORM_DISPLAYTRACE_H_
+#define UDISPLAY_PLATFORM_DISPLAYTRACE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * Set to 1 (eg: in the "macros" section of mbed_app.json) to log
+ * every DisplayInterface transaction into the trace ring buffer.
+ * When 0, the trace hooks expand to nothing.
+ */
+#ifndef UDISPLAY_TRACE_ENABLED
+#define UDISPLAY_TRACE_ENABLED 0
+#endif
+
+/** Number of records held in the trace ring buffer (must be a power of 2) */
+#ifndef UDISPLAY_TRACE_BUFFER_SIZE
+#define UDISPLAY_TRACE_BUFFER_SIZE 256
+#endif
+
+/** Record flag: the transaction started with at least one command byte */
+#define DISPLAY_TRACE_FLAG_HAS_COMMAND	0x01
+
+/**
+ * A single logged transaction
+ */
+typedef struct {
+	uint32_t sequence;			/** Sequence number, written last (0 -> slot never written) */
+	uint32_t timestamp_us;		/** Time the transaction started */
+	uint32_t duration_us;		/** Time the transaction took to complete */
+	uint32_t length;			/** Total number of bytes in the transaction */
+	uint32_t source;			/** Identifies the interface that logged the record */
+	uint16_t num_cmd_bytes;		/** Number of command bytes at beginning of transaction */
+	uint8_t command;			/** First command byte (if DISPLAY_TRACE_FLAG_HAS_COMMAND) */
+	uint8_t flags;				/** DISPLAY_TRACE_FLAG_* */
+} display_trace_record_t;
+
+#if UDISPLAY_TRACE_ENABLED
+
+#include "hal/us_ticker_api.h"
+
+/**
+ * Global transaction trace buffer
+ *
+ * Records are reserved with an atomic increment so logging is lock-free
+ * and may be done from interrupt context (eg: a SPIM completion handler).
+ * When the buffer wraps, the oldest records are overwritten.
+ *
+ * Dumps are written as text lines prefixed with "udt," so they can be
+ * captured from a serial console and converted to Chrome trace-event JSON
+ * with tools/trace2chrome.py
+ */
+class DisplayTrace
+{
+	public:
+
+		/**
+		 * Timestamp source used for trace records
+		 * @retval current time in microseconds
+		 */
+		static uint32_t now(void) {
+			return us_ticker_read();
+		}
+
+		/**
+		 * Logs a transaction into the ring buffer
+		 * @note ISR safe
+		 *
+		 * @param[in] source Handle of the logging interface
+		 * @param[in] start_us Timestamp taken when the transaction started
+		 * @param[in] command First command byte of the transaction
+		 * @param[in] num_cmd_bytes Number of command bytes at beginning of transaction
+		 * @param[in] length Total number of bytes in the transaction
+		 */
+		static void log(const void* source, uint32_t start_us, uint8_t command,
+				uint32_t num_cmd_bytes, uint32_t length);
+
+		/**
+		 * Copies the buffered records out, oldest first
+		 * @param[out] records Array to fill
+		 * @param[in] max_records Size of the records array
+		 * @retval number of records copied
+		 */
+		static uint32_t snapshot(display_trace_record_t* records, uint32_t max_records);
+
+		/**
+		 * Writes the buffered records to a stream in text form
+		 * @param[in] stream Output stream (eg: stdout)
+		 */
+		static void dump(FILE* stream = stdout);
+
+		/**
+		 * Discards all buffered records
+		 */
+		static void clear(void);
+
+	private:
+
+		static display_trace_record_t _records[UDISPLAY_TRACE_BUFFER_SIZE];
+
+		/** Number of records ever reserved */
+		static volatile uint32_t _head;
+
+};
+
+/** Declares a local holding the start timestamp of a transaction */
+#define UDISPLAY_TRACE_START(start) uint32_t start = DisplayTrace::now()
+
+/** Logs a buffered transaction that started at the given timestamp */
+#define UDISPLAY_TRACE_LOG(start, buffer, num_cmd_bytes, length) \
+	DisplayTrace::log(this, (start), ((num_cmd_bytes) ? (buffer)[0] : 0), (num_cmd_bytes), (length))
+
+#else
+
+#define UDISPLAY_TRACE_START(start)
+#define UDISPLAY_TRACE_LOG(start, buffer, num_cmd_bytes, length)
+
+#endif /* UDISPLAY_TRACE_ENABLED */
+
+#endif /* UDISPLAY_PLATFORM_DISPLAYTRACE_H_ */
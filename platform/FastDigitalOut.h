@@ -0,0 +1,81 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UDISPLAY_PLATFORM_FASTDIGITALOUT_H_
+#define UDISPLAY_PLATFORM_FASTDIGITALOUT_H_
+
+#include "PinNames.h"
+#include "fast_gpio_api.h"
+
+#if !defined(UDISPLAY_FAST_GPIO)
+#include "drivers/DigitalOut.h"
+#endif
+
+/**
+ * Digital output for pins toggled on every transaction (chip select, D/C...)
+ *
+ * Uses the fast GPIO HAL when the target provides it, mbed::DigitalOut otherwise.
+ */
+class FastDigitalOut
+{
+	public:
+
+		/**
+		 * @param[in] pin Output pin (may be NC)
+		 * @param[in] value Initial value
+		 */
+		FastDigitalOut(PinName pin, int value = 0)
+#if !defined(UDISPLAY_FAST_GPIO)
+			: _out(pin, value)
+#endif
+		{
+#if defined(UDISPLAY_FAST_GPIO)
+			fast_gpio_init(&_gpio, pin, value);
+#endif
+		}
+
+		/**
+		 * Sets the output
+		 * @param[in] value 0 for low, anything else for high
+		 */
+		void write(int value) {
+#if defined(UDISPLAY_FAST_GPIO)
+			fast_gpio_write(&_gpio, value);
+#else
+			_out.write(value);
+#endif
+		}
+
+		/**
+		 * Shorthand for write()
+		 */
+		FastDigitalOut& operator=(int value) {
+			write(value);
+			return *this;
+		}
+
+	private:
+
+#if defined(UDISPLAY_FAST_GPIO)
+		fast_gpio_t _gpio;
+#else
+		mbed::DigitalOut _out;
+#endif
+
+};
+
+#endif /* UDISPLAY_PLATFORM_FASTDIGITALOUT_H_ */
@@ -0,0 +1,243 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FrameMailbox.h"
+
+#include <string.h>
+
+#define MAILBOX_POSTED_FLAG 0x1
+
+FrameMailbox::FrameMailbox(void) : _sequence(0), _dropped(0), _merged(0),
+		_release_callback(NULL), _mutex(), _posted_evt() {
+	memset(_slots, 0, sizeof(_slots));
+}
+
+bool FrameMailbox::post(uint32_t region_id, const display_rect_t& rect,
+		const uint8_t* data, uint32_t length) {
+
+	const uint8_t* replaced = NULL;
+	bool displaced = false;
+
+	_mutex.lock();
+
+	uint32_t slot;
+	for(slot = 0; slot < FRAME_MAILBOX_SLOTS; slot++) {
+		if(_slots[slot].used && _slots[slot].entry.region_id == region_id) {
+			break;
+		}
+	}
+
+	if(slot < FRAME_MAILBOX_SLOTS) {
+		// Latest wins: replace the pending frame but keep its place in line
+		replaced = _slots[slot].entry.data;
+		_dropped++;
+	} else {
+		slot = find_free_slot();
+		if(slot == FRAME_MAILBOX_SLOTS) {
+			// Full: the newest frame is never the one dropped
+			slot = make_room();
+			if(_slots[slot].used) {
+				replaced = _slots[slot].entry.data;
+				displaced = true;
+				_dropped++;
+			}
+		}
+		_slots[slot].used = true;
+		_slots[slot].sequence = _sequence++;
+	}
+
+	_slots[slot].entry.region_id = region_id;
+	_slots[slot].entry.rect = rect;
+	_slots[slot].entry.data = data;
+	_slots[slot].entry.length = length;
+	_posted_evt.set(MAILBOX_POSTED_FLAG);
+
+	_mutex.unlock();
+
+	if(replaced && _release_callback) {
+		_release_callback(replaced);
+	}
+
+	return !displaced;
+}
+
+void FrameMailbox::mark_dirty(const display_rect_t& rect) {
+
+	display_rect_t area = rect;
+	uint32_t target = FRAME_MAILBOX_SLOTS;
+	bool changed;
+
+	_mutex.lock();
+
+	// Absorb every pending dirty rectangle touching the (growing) area
+	do {
+		changed = false;
+		for(uint32_t i = 0; i < FRAME_MAILBOX_SLOTS; i++) {
+			mailbox_slot_t& slot = _slots[i];
+			if(i == target || !slot.used ||
+					slot.entry.region_id != FRAME_MAILBOX_DIRTY_REGION ||
+					!touches(slot.entry.rect, area)) {
+				continue;
+			}
+
+			merge_into(area, slot.entry.rect);
+			_merged++;
+			changed = true;
+
+			if(target == FRAME_MAILBOX_SLOTS) {
+				target = i;
+			} else {
+				// Keep the earliest place in line among the merged entries
+				if(slot.sequence < _slots[target].sequence) {
+					_slots[target].sequence = slot.sequence;
+				}
+				slot.used = false;
+			}
+		}
+	} while(changed);
+
+	if(target == FRAME_MAILBOX_SLOTS) {
+		target = find_free_slot();
+		if(target < FRAME_MAILBOX_SLOTS) {
+			_slots[target].used = true;
+			_slots[target].sequence = _sequence++;
+		} else {
+			// Out of slots, grow the oldest pending dirty rectangle instead
+			for(uint32_t i = 0; i < FRAME_MAILBOX_SLOTS; i++) {
+				if(_slots[i].used && _slots[i].entry.region_id == FRAME_MAILBOX_DIRTY_REGION &&
+						(target == FRAME_MAILBOX_SLOTS || _slots[i].sequence < _slots[target].sequence)) {
+					target = i;
+				}
+			}
+			if(target == FRAME_MAILBOX_SLOTS) {
+				_dropped++;
+				_mutex.unlock();
+				return;
+			}
+			merge_into(area, _slots[target].entry.rect);
+			_merged++;
+		}
+	}
+
+	_slots[target].entry.region_id = FRAME_MAILBOX_DIRTY_REGION;
+	_slots[target].entry.rect = area;
+	_slots[target].entry.data = NULL;
+	_slots[target].entry.length = 0;
+	_posted_evt.set(MAILBOX_POSTED_FLAG);
+
+	_mutex.unlock();
+}
+
+bool FrameMailbox::take(frame_mailbox_entry_t& entry, uint32_t timeout_ms) {
+	while(true) {
+		_mutex.lock();
+		uint32_t oldest = FRAME_MAILBOX_SLOTS;
+		for(uint32_t i = 0; i < FRAME_MAILBOX_SLOTS; i++) {
+			if(_slots[i].used &&
+					(oldest == FRAME_MAILBOX_SLOTS || _slots[i].sequence < _slots[oldest].sequence)) {
+				oldest = i;
+			}
+		}
+		if(oldest < FRAME_MAILBOX_SLOTS) {
+			entry = _slots[oldest].entry;
+			_slots[oldest].used = false;
+			_mutex.unlock();
+			return true;
+		}
+		_mutex.unlock();
+
+		uint32_t flags = _posted_evt.wait_any(MAILBOX_POSTED_FLAG, timeout_ms);
+		if(flags & osFlagsError) {
+			return false;
+		}
+	}
+}
+
+uint32_t FrameMailbox::pending(void) {
+	uint32_t count = 0;
+	_mutex.lock();
+	for(uint32_t i = 0; i < FRAME_MAILBOX_SLOTS; i++) {
+		if(_slots[i].used) {
+			count++;
+		}
+	}
+	_mutex.unlock();
+	return count;
+}
+
+uint32_t FrameMailbox::find_free_slot(void) {
+	for(uint32_t i = 0; i < FRAME_MAILBOX_SLOTS; i++) {
+		if(!_slots[i].used) {
+			return i;
+		}
+	}
+	return FRAME_MAILBOX_SLOTS;
+}
+
+uint32_t FrameMailbox::make_room(void) {
+	uint32_t oldest_frame = FRAME_MAILBOX_SLOTS;
+	uint32_t oldest_dirty = FRAME_MAILBOX_SLOTS;
+	uint32_t next_dirty = FRAME_MAILBOX_SLOTS;
+	for(uint32_t i = 0; i < FRAME_MAILBOX_SLOTS; i++) {
+		if(_slots[i].entry.region_id != FRAME_MAILBOX_DIRTY_REGION) {
+			if(oldest_frame == FRAME_MAILBOX_SLOTS || _slots[i].sequence < _slots[oldest_frame].sequence) {
+				oldest_frame = i;
+			}
+		} else if(oldest_dirty == FRAME_MAILBOX_SLOTS || _slots[i].sequence < _slots[oldest_dirty].sequence) {
+			next_dirty = oldest_dirty;
+			oldest_dirty = i;
+		} else if(next_dirty == FRAME_MAILBOX_SLOTS || _slots[i].sequence < _slots[next_dirty].sequence) {
+			next_dirty = i;
+		}
+	}
+
+	if(oldest_frame < FRAME_MAILBOX_SLOTS) {
+		return oldest_frame;
+	}
+
+	if(next_dirty == FRAME_MAILBOX_SLOTS) {
+		// A single slot holding a dirty rectangle
+		return oldest_dirty;
+	}
+
+	// Only dirty rectangles are pending: merge the two oldest so none is lost
+	merge_into(_slots[oldest_dirty].entry.rect, _slots[next_dirty].entry.rect);
+	_merged++;
+	_slots[next_dirty].used = false;
+	return next_dirty;
+}
+
+bool FrameMailbox::touches(const display_rect_t& a, const display_rect_t& b) {
+	// Adjacent rectangles are merged too, saving an address window setup
+	return (a.x0 <= (b.x1 + 1)) && (b.x0 <= (a.x1 + 1)) &&
+			(a.y0 <= (b.y1 + 1)) && (b.y0 <= (a.y1 + 1));
+}
+
+void FrameMailbox::merge_into(display_rect_t& a, const display_rect_t& b) {
+	if(b.x0 < a.x0) {
+		a.x0 = b.x0;
+	}
+	if(b.y0 < a.y0) {
+		a.y0 = b.y0;
+	}
+	if(b.x1 > a.x1) {
+		a.x1 = b.x1;
+	}
+	if(b.y1 > a.y1) {
+		a.y1 = b.y1;
+	}
+}
@@ -0,0 +1,165 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UDISPLAY_PLATFORM_FRAMEMAILBOX_H_
+#define UDISPLAY_PLATFORM_FRAMEMAILBOX_H_
+
+#include <stdint.h>
+
+#include "DisplayRect.h"
+
+#include "platform/Callback.h"
+#include "rtos/Mutex.h"
+#include "rtos/EventFlags.h"
+
+/** Maximum number of pending entries */
+#ifndef FRAME_MAILBOX_SLOTS
+#define FRAME_MAILBOX_SLOTS 8
+#endif
+
+/** Region ID used for dirty rectangles posted with mark_dirty() */
+#define FRAME_MAILBOX_DIRTY_REGION 0xFFFFFFFF
+
+/**
+ * Pending mailbox entry
+ */
+typedef struct {
+	uint32_t region_id;			/** Region the frame updates (FRAME_MAILBOX_DIRTY_REGION for dirty rectangles) */
+	display_rect_t rect;		/** Area of the display to update */
+	const uint8_t* data;		/** Frame payload (NULL for dirty rectangles) */
+	uint32_t length;			/** Length of the frame payload */
+} frame_mailbox_entry_t;
+
+/**
+ * Latest-wins frame mailbox
+ *
+ * Decouples a producer that may render faster than the bus drains from the
+ * thread transmitting to the display. A frame posted for a region that
+ * already has a pending (not yet taken) frame replaces it in place, and
+ * overlapping dirty rectangles are merged, so the amount of pending work
+ * (and display latency) stays bounded under load. When every slot is in
+ * use, the oldest pending frame makes room for the new one (or, if only
+ * dirty rectangles are pending, the two oldest are merged).
+ *
+ * Frame payloads are owned by the producer. Payloads that are replaced
+ * before being taken are handed back through the release callback.
+ *
+ * @note Thread safe, not ISR safe
+ */
+class FrameMailbox
+{
+	public:
+
+		FrameMailbox(void);
+
+		virtual ~FrameMailbox(void) { }
+
+		/**
+		 * Attach a callback executed when a pending payload is dropped
+		 * because a newer frame replaced it or needed its slot
+		 */
+		void attach_release(mbed::Callback<void(const uint8_t*)> cb) {
+			_release_callback = cb;
+		}
+
+		/**
+		 * Posts a frame for a region, replacing any pending frame for the same region
+		 * @note The frame is always posted. If the mailbox is full, the oldest
+		 * pending frame (of another region) is dropped to make room
+		 * @param[in] region_id Application-defined region identifier
+		 * @param[in] rect Area of the display the frame updates
+		 * @param[in] data Frame payload
+		 * @param[in] length Length of the frame payload
+		 * @retval false if another region's pending frame was dropped to make room
+		 */
+		bool post(uint32_t region_id, const display_rect_t& rect,
+				const uint8_t* data, uint32_t length);
+
+		/**
+		 * Marks an area of the display as dirty, merging it with pending dirty areas
+		 * @param[in] rect Dirty area
+		 */
+		void mark_dirty(const display_rect_t& rect);
+
+		/**
+		 * Takes the oldest pending entry
+		 * @param[out] entry Taken entry
+		 * @param[in] timeout_ms Maximum time to wait for an entry
+		 * @retval true if an entry was taken, false on timeout
+		 */
+		bool take(frame_mailbox_entry_t& entry, uint32_t timeout_ms = osWaitForever);
+
+		/**
+		 * Gets the number of pending entries
+		 */
+		uint32_t pending(void);
+
+		/**
+		 * Gets the number of frames that were dropped (replaced or displaced)
+		 */
+		uint32_t dropped(void) const {
+			return _dropped;
+		}
+
+		/**
+		 * Gets the number of dirty rectangles merged into pending ones
+		 */
+		uint32_t merged(void) const {
+			return _merged;
+		}
+
+	private:
+
+		typedef struct {
+			frame_mailbox_entry_t entry;
+			uint32_t sequence;		/** Order the entry was first posted in */
+			bool used;
+		} mailbox_slot_t;
+
+		/** Finds a free slot, returns FRAME_MAILBOX_SLOTS if full */
+		uint32_t find_free_slot(void);
+
+		/**
+		 * Picks the slot to reuse when the mailbox is full: the oldest
+		 * pending frame, or a slot freed by merging the two oldest dirty
+		 * rectangles (then returned unused)
+		 */
+		uint32_t make_room(void);
+
+		/** Checks if two rectangles overlap or touch */
+		static bool touches(const display_rect_t& a, const display_rect_t& b);
+
+		/** Grows a rectangle to contain another */
+		static void merge_into(display_rect_t& a, const display_rect_t& b);
+
+		mailbox_slot_t _slots[FRAME_MAILBOX_SLOTS];
+
+		uint32_t _sequence;
+
+		uint32_t _dropped;
+
+		uint32_t _merged;
+
+		mbed::Callback<void(const uint8_t*)> _release_callback;
+
+		rtos::Mutex _mutex;
+
+		rtos::EventFlags _posted_evt;
+
+};
+
+#endif /* UDISPLAY_PLATFORM_FRAMEMAILBOX_H_ */
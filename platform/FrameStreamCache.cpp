@@ -0,0 +1,149 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FrameStreamCache.h"
+
+#include <string.h>
+
+FrameStreamCache::FrameStreamCache(uint8_t* buffer, uint32_t size, DisplayInterface* passthrough) :
+		_buffer(buffer), _capacity(size), _length(0), _last(0), _has_last(false),
+		_capturing(false), _overflow(false), _valid(false), _passthrough(passthrough) {
+}
+
+void FrameStreamCache::begin_capture(void) {
+	_length = 0;
+	_has_last = false;
+	_overflow = false;
+	_valid = false;
+	_capturing = true;
+}
+
+bool FrameStreamCache::end_capture(void) {
+	_capturing = false;
+	_valid = !_overflow;
+	return _valid;
+}
+
+uint32_t FrameStreamCache::replay(DisplayInterface& interface) const {
+	if(!_valid) {
+		return 0;
+	}
+	return replay(_buffer, _length, interface);
+}
+
+uint32_t FrameStreamCache::replay(const uint8_t* stream, uint32_t length, DisplayInterface& interface) {
+	uint32_t offset = 0;
+	uint32_t transactions = 0;
+
+	while((offset + FRAME_CACHE_HEADER_SIZE) <= length) {
+		uint32_t num_cmd_bytes = stream[offset];
+		uint32_t len = stream[offset + 1] |
+				(stream[offset + 2] << 8) |
+				(stream[offset + 3] << 16);
+		const uint8_t* payload = &stream[offset + FRAME_CACHE_HEADER_SIZE];
+
+		if((offset + FRAME_CACHE_HEADER_SIZE + len) > length) {
+			break; // Truncated stream
+		}
+
+		// Payloads are written in place, no copy is made
+		if(len == 1) {
+			interface.write(payload[0], (num_cmd_bytes != 0));
+		} else {
+			interface.write(payload, num_cmd_bytes, len);
+		}
+
+		offset += FRAME_CACHE_HEADER_SIZE + len;
+		transactions++;
+	}
+
+	return transactions;
+}
+
+void FrameStreamCache::write(uint8_t data, bool is_cmd) {
+	if(_capturing) {
+		capture(&data, (is_cmd ? 1 : 0), 1);
+	}
+	if(_passthrough) {
+		_passthrough->write(data, is_cmd);
+	}
+}
+
+void FrameStreamCache::write(const uint8_t* buffer, uint32_t num_cmd_bytes, uint32_t buf_len) {
+	if(_capturing) {
+		capture(buffer, num_cmd_bytes, buf_len);
+	}
+	if(_passthrough) {
+		_passthrough->write(buffer, num_cmd_bytes, buf_len);
+	}
+}
+
+uint8_t FrameStreamCache::read(uint8_t* buffer, uint32_t size) {
+	if(_passthrough) {
+		return _passthrough->read(buffer, size);
+	}
+	return 0;
+}
+
+void FrameStreamCache::capture(const uint8_t* buffer, uint32_t num_cmd_bytes, uint32_t buf_len) {
+	if(_overflow || buf_len == 0) {
+		return;
+	}
+
+	if(_has_last) {
+		uint32_t last_cmd_bytes = _buffer[_last];
+		uint32_t last_len = _buffer[_last + 1] |
+				(_buffer[_last + 2] << 8) |
+				(_buffer[_last + 3] << 16);
+
+		// Data continues the last transaction, or the last transaction
+		// was only command bytes and this one can be appended to it
+		bool continuation = (num_cmd_bytes == 0);
+		bool after_command = (last_len == last_cmd_bytes) &&
+				((last_cmd_bytes + num_cmd_bytes) <= FRAME_CACHE_MAX_CMD_BYTES);
+
+		if((continuation || after_command) && (last_len + buf_len) <= FRAME_CACHE_MAX_LENGTH) {
+			if((_length + buf_len) > _capacity) {
+				_overflow = true;
+				return;
+			}
+			memcpy(&_buffer[_length], buffer, buf_len);
+			_length += buf_len;
+			write_header(_last, last_cmd_bytes + num_cmd_bytes, last_len + buf_len);
+			return;
+		}
+	}
+
+	if(num_cmd_bytes > FRAME_CACHE_MAX_CMD_BYTES || buf_len > FRAME_CACHE_MAX_LENGTH ||
+			(_length + FRAME_CACHE_HEADER_SIZE + buf_len) > _capacity) {
+		_overflow = true;
+		return;
+	}
+
+	_last = _length;
+	_has_last = true;
+	write_header(_last, num_cmd_bytes, buf_len);
+	memcpy(&_buffer[_length + FRAME_CACHE_HEADER_SIZE], buffer, buf_len);
+	_length += FRAME_CACHE_HEADER_SIZE + buf_len;
+}
+
+void FrameStreamCache::write_header(uint32_t offset, uint32_t num_cmd_bytes, uint32_t length) {
+	_buffer[offset] = (uint8_t) num_cmd_bytes;
+	_buffer[offset + 1] = (uint8_t)(length & 0xFF);
+	_buffer[offset + 2] = (uint8_t)((length >> 8) & 0xFF);
+	_buffer[offset + 3] = (uint8_t)((length >> 16) & 0xFF);
+}
@@ -0,0 +1,176 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UDISPLAY_PLATFORM_FRAMESTREAMCACHE_H_
+#define UDISPLAY_PLATFORM_FRAMESTREAMCACHE_H_
+
+#include <stddef.h>
+
+#include "DisplayInterface.h"
+
+/**
+ * Maximum number of command bytes merged into a single cached transaction.
+ * Limited by the nRF52840 SPIM3 hardware D/C counter (DisplaySPI), where a
+ * count of 15 means the whole transfer is command bytes
+ */
+#ifndef FRAME_CACHE_MAX_CMD_BYTES
+#define FRAME_CACHE_MAX_CMD_BYTES 14
+#endif
+
+/** Size of the header preceding each cached transaction */
+#define FRAME_CACHE_HEADER_SIZE 4
+
+/** Largest payload a single cached transaction can hold (24-bit length) */
+#define FRAME_CACHE_MAX_LENGTH 0xFFFFFF
+
+/**
+ * Pre-encoded frame stream cache
+ *
+ * Captures the finished transaction stream of a screen (command bytes and
+ * converted pixel data) into a compact buffer so the screen can later be
+ * shown again with no rendering, address-window setup or pixel conversion.
+ *
+ * While capturing, data-only writes are appended to the preceding
+ * transaction and a command-only transaction absorbs the one following it
+ * (eg: RAMWR followed by the pixel data), so replaying takes as few
+ * transfers as possible.
+ *
+ * Stream format, one entry per transaction:
+ * - byte 0: number of command bytes
+ * - bytes 1-3: total length (little endian)
+ * - payload
+ *
+ * A captured stream may be copied into flash (eg: as a const array) and
+ * replayed from there with FrameStreamCache::replay(stream, len, interface).
+ */
+class FrameStreamCache : public DisplayInterface
+{
+	public:
+
+		/**
+		 * Instantiate a frame stream cache
+		 * @param[in] buffer Storage for the captured stream
+		 * @param[in] size Size of the storage buffer
+		 * @param[in] passthrough (optional) Interface that also receives
+		 * the transactions while capturing, so the screen is shown as it is cached
+		 */
+		FrameStreamCache(uint8_t* buffer, uint32_t size, DisplayInterface* passthrough = NULL);
+
+		virtual ~FrameStreamCache(void) { }
+
+		/**
+		 * Discards the cached stream and starts capturing a new one
+		 */
+		void begin_capture(void);
+
+		/**
+		 * Stops capturing
+		 * @retval true if the complete screen fit in the cache
+		 */
+		bool end_capture(void);
+
+		/**
+		 * Indicates if the cache holds a complete screen
+		 */
+		bool valid(void) const {
+			return _valid;
+		}
+
+		/**
+		 * Gets the captured stream
+		 */
+		const uint8_t* data(void) const {
+			return _buffer;
+		}
+
+		/**
+		 * Gets the length of the captured stream
+		 */
+		uint32_t size(void) const {
+			return _length;
+		}
+
+		/**
+		 * Replays the cached screen into an interface
+		 * @param[in] interface Interface to replay into
+		 * @retval number of transactions written, or 0 if the cache isn't valid
+		 */
+		uint32_t replay(DisplayInterface& interface) const;
+
+		/**
+		 * Replays a captured stream into an interface
+		 * @param[in] stream Captured stream (may reside in flash)
+		 * @param[in] length Length of the stream
+		 * @param[in] interface Interface to replay into
+		 * @retval number of transactions written
+		 */
+		static uint32_t replay(const uint8_t* stream, uint32_t length, DisplayInterface& interface);
+
+		/**
+		 * Writes a single-byte to the display interface
+		 * @param[in] data Single byte to send to the display interface
+		 * @param[in] is_cmd Is the byte a command (true) or data (false)?
+		 */
+		virtual void write(uint8_t data, bool is_cmd = true);
+
+		/**
+		 * Writes a buffer to the display interface
+		 * @param[in] buffer pointer to buffer of bytes to transmit
+		 * @param[in] num_cmd_bytes Number of command bytes at beginning of buffer
+		 * @param[in] buf_len Total number of bytes in payload buffer
+		 */
+		virtual void write(const uint8_t* buffer, uint32_t num_cmd_bytes, uint32_t buf_len);
+
+		/**
+		 * Reads a buffer from the display interface
+		 * @note Reads are forwarded to the passthrough interface, if any
+		 * @param[out] buffer to fill with data
+		 * @param[in] size Size of buffer
+		 * @retval actual number of bytes read (may always be 0 if unsupported)
+		 */
+		virtual uint8_t read(uint8_t* buffer, uint32_t size);
+
+	private:
+
+		/** Appends a transaction to the stream, merging it with the last one if possible */
+		void capture(const uint8_t* buffer, uint32_t num_cmd_bytes, uint32_t buf_len);
+
+		/** Writes a transaction header at the given offset */
+		void write_header(uint32_t offset, uint32_t num_cmd_bytes, uint32_t length);
+
+		uint8_t* _buffer;
+
+		uint32_t _capacity;
+
+		uint32_t _length;
+
+		/** Offset of the last transaction header, valid if _has_last */
+		uint32_t _last;
+
+		bool _has_last;
+
+		bool _capturing;
+
+		bool _overflow;
+
+		bool _valid;
+
+		DisplayInterface* _passthrough;
+
+};
+
+#endif /* UDISPLAY_PLATFORM_FRAMESTREAMCACHE_H_ */
@@ -0,0 +1,246 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LatencyTracer.h"
+
+#include <string.h>
+
+#include "platform/mbed_critical.h"
+#include "hal/us_ticker_api.h"
+
+void LatencyHistogram::add(uint32_t value_us) {
+	_buckets[bucket_of(value_us)]++;
+	_count++;
+	if(value_us > _max) {
+		_max = value_us;
+	}
+}
+
+void LatencyHistogram::summarize(latency_summary_t& summary) const {
+	summary.count = _count;
+	summary.p50 = percentile(500);
+	summary.p99 = percentile(990);
+	summary.max = _max;
+}
+
+void LatencyHistogram::reset(void) {
+	memset(_buckets, 0, sizeof(_buckets));
+	_count = 0;
+	_max = 0;
+}
+
+uint32_t LatencyHistogram::bucket_of(uint32_t value) {
+	if(value < 4) {
+		return value;
+	}
+
+	// Find the power of 2 the value falls in, then split it into 4 sub-buckets
+	uint32_t octave = 2;
+	while((value >> (octave + 1)) != 0) {
+		octave++;
+	}
+	uint32_t sub_bucket = (value >> (octave - 2)) & 0x3;
+	uint32_t bucket = ((octave - 1) * 4) + sub_bucket;
+
+	return (bucket < LATENCY_HISTOGRAM_BUCKETS) ? bucket : (LATENCY_HISTOGRAM_BUCKETS - 1);
+}
+
+uint32_t LatencyHistogram::bucket_upper_bound(uint32_t bucket) {
+	if(bucket < 4) {
+		return bucket;
+	}
+
+	uint32_t octave = (bucket / 4) + 1;
+	uint32_t lower = (4 + (bucket % 4)) << (octave - 2);
+	return lower + (1UL << (octave - 2)) - 1;
+}
+
+uint32_t LatencyHistogram::percentile(uint32_t per_mille) const {
+	if(_count == 0) {
+		return 0;
+	}
+
+	// Rank of the sample at the requested percentile (rounded up)
+	uint32_t rank = (uint32_t)((((uint64_t) _count * per_mille) + 999) / 1000);
+	uint32_t seen = 0;
+	for(uint32_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+		seen += _buckets[i];
+		if(seen >= rank) {
+			uint32_t bound = bucket_upper_bound(i);
+			return (bound < _max) ? bound : _max;
+		}
+	}
+
+	return _max;
+}
+
+LatencyTracer::LatencyTracer(DisplayInterface& interface, PinName te) :
+		_interface(interface), _te(NULL), _frame_callback(NULL), _state(FRAME_IDLE) {
+
+	memset(&_frame, 0, sizeof(_frame));
+
+	if(te != NC) {
+		_te = new mbed::InterruptIn(te);
+		_te->rise(mbed::callback(this, &LatencyTracer::te_handler));
+	}
+}
+
+LatencyTracer::~LatencyTracer(void) {
+	if(_te != NULL) {
+		delete _te;
+		_te = NULL;
+	}
+}
+
+void LatencyTracer::begin_frame(uint32_t id, uint32_t start_us) {
+	latency_frame_t completed;
+	bool notify = false;
+
+	core_util_critical_section_enter();
+
+	// A frame still waiting for vsync is completed without a panel latch time
+	if(_state == FRAME_WAIT_VSYNC) {
+		commit_frame(completed);
+		notify = true;
+	}
+
+	memset(&_frame, 0, sizeof(_frame));
+	_frame.id = id;
+	_frame.start_us = start_us;
+	_state = FRAME_ACTIVE;
+
+	core_util_critical_section_exit();
+
+	if(notify && _frame_callback) {
+		_frame_callback(completed);
+	}
+}
+
+void LatencyTracer::end_frame(void) {
+	latency_frame_t completed;
+	bool notify = false;
+
+	core_util_critical_section_enter();
+
+	if(_state == FRAME_ACTIVE) {
+		if(_frame.queued_us == 0) {
+			// Nothing was written, treat the frame as completing now
+			_frame.queued_us = _frame.started_us = _frame.finished_us = us_ticker_read();
+		} else if(_frame.started_us == 0) {
+			// No pixel data was written, count the whole frame as bus time
+			_frame.started_us = _frame.queued_us;
+		}
+
+		if(_te != NULL) {
+			_state = FRAME_WAIT_VSYNC;
+		} else {
+			commit_frame(completed);
+			notify = true;
+		}
+	}
+
+	core_util_critical_section_exit();
+
+	if(notify && _frame_callback) {
+		_frame_callback(completed);
+	}
+}
+
+void LatencyTracer::get_report(latency_report_t& report) {
+	core_util_critical_section_enter();
+	_queue.summarize(report.queue);
+	_wait.summarize(report.wait);
+	_bus.summarize(report.bus);
+	_panel.summarize(report.panel);
+	_total.summarize(report.total);
+	core_util_critical_section_exit();
+}
+
+void LatencyTracer::reset(void) {
+	core_util_critical_section_enter();
+	_queue.reset();
+	_wait.reset();
+	_bus.reset();
+	_panel.reset();
+	_total.reset();
+	core_util_critical_section_exit();
+}
+
+void LatencyTracer::write(uint8_t data, bool is_cmd) {
+	transfer_starting(is_cmd ? 0 : 1);
+	_interface.write(data, is_cmd);
+	transfer_done();
+}
+
+void LatencyTracer::write(const uint8_t* buffer, uint32_t num_cmd_bytes, uint32_t buf_len) {
+	transfer_starting(buf_len - num_cmd_bytes);
+	_interface.write(buffer, num_cmd_bytes, buf_len);
+	transfer_done();
+}
+
+void LatencyTracer::write_strided(const uint8_t* base, uint32_t stride, uint32_t row_bytes,
+		uint32_t rows) {
+	transfer_starting(row_bytes * rows);
+	_interface.write_strided(base, stride, row_bytes, rows);
+	transfer_done();
+}
+
+void LatencyTracer::transfer_starting(uint32_t data_bytes) {
+	if(_state != FRAME_ACTIVE) {
+		return;
+	}
+
+	uint32_t now = us_ticker_read();
+	if(_frame.queued_us == 0) {
+		_frame.queued_us = now;
+	}
+	if(_frame.started_us == 0 && data_bytes >= LATENCY_TRACER_MIN_PIXEL_BYTES) {
+		_frame.started_us = now;
+	}
+}
+
+void LatencyTracer::transfer_done(void) {
+	if(_state == FRAME_ACTIVE) {
+		_frame.finished_us = us_ticker_read();
+	}
+}
+
+void LatencyTracer::te_handler(void) {
+	if(_state == FRAME_WAIT_VSYNC) {
+		latency_frame_t completed;
+		_frame.vsync_us = us_ticker_read();
+		commit_frame(completed);
+		if(_frame_callback) {
+			_frame_callback(completed);
+		}
+	}
+}
+
+void LatencyTracer::commit_frame(latency_frame_t& completed) {
+	_queue.add(_frame.queued_us - _frame.start_us);
+	_wait.add(_frame.started_us - _frame.queued_us);
+	_bus.add(_frame.finished_us - _frame.started_us);
+	if(_frame.vsync_us != 0) {
+		_panel.add(_frame.vsync_us - _frame.finished_us);
+		_total.add(_frame.vsync_us - _frame.start_us);
+	} else {
+		_total.add(_frame.finished_us - _frame.start_us);
+	}
+
+	completed = _frame;
+	_state = FRAME_IDLE;
+}
@@ -0,0 +1,245 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UDISPLAY_PLATFORM_LATENCYTRACER_H_
+#define UDISPLAY_PLATFORM_LATENCYTRACER_H_
+
+#include "DisplayInterface.h"
+
+#include "platform/Callback.h"
+#include "drivers/InterruptIn.h"
+
+/**
+ * Data payloads at least this long are considered pixel data.
+ * Shorter payloads are taken to be command parameters (eg: CASET/RASET)
+ */
+#ifndef LATENCY_TRACER_MIN_PIXEL_BYTES
+#define LATENCY_TRACER_MIN_PIXEL_BYTES 8
+#endif
+
+/** Number of histogram buckets (4 per power of 2, 80 buckets covers ~2 seconds) */
+#define LATENCY_HISTOGRAM_BUCKETS 80
+
+/**
+ * Timeline of a single traced frame (all timestamps in microseconds)
+ */
+typedef struct {
+	uint32_t id;				/** Application-assigned frame ID */
+	uint32_t start_us;			/** Application timestamp (eg: input event) */
+	uint32_t queued_us;			/** First write for the frame reached the interface */
+	uint32_t started_us;		/** First pixel transfer started */
+	uint32_t finished_us;		/** Last transfer of the frame completed */
+	uint32_t vsync_us;			/** First TE pulse after completion (0 if none) */
+} latency_frame_t;
+
+/**
+ * Percentiles of a single latency stage (all values in microseconds)
+ */
+typedef struct {
+	uint32_t count;
+	uint32_t p50;
+	uint32_t p99;
+	uint32_t max;
+} latency_summary_t;
+
+/**
+ * Latency report, broken down by pipeline stage
+ */
+typedef struct {
+	latency_summary_t queue;	/** start -> queued: application/render time */
+	latency_summary_t wait;		/** queued -> started: window setup and queueing */
+	latency_summary_t bus;		/** started -> finished: time on the wire */
+	latency_summary_t panel;	/** finished -> vsync: waiting for the panel to latch */
+	latency_summary_t total;	/** start -> vsync (or finished without TE) */
+} latency_report_t;
+
+/**
+ * Log-linear latency histogram
+ */
+class LatencyHistogram
+{
+	public:
+
+		LatencyHistogram(void) {
+			reset();
+		}
+
+		/**
+		 * Adds a sample to the histogram
+		 * @param[in] value_us Latency sample
+		 */
+		void add(uint32_t value_us);
+
+		/**
+		 * Summarizes the histogram
+		 * @param[out] summary Percentiles of the recorded samples
+		 */
+		void summarize(latency_summary_t& summary) const;
+
+		/**
+		 * Discards all samples
+		 */
+		void reset(void);
+
+	private:
+
+		/** Gets the bucket a value falls into */
+		static uint32_t bucket_of(uint32_t value);
+
+		/** Gets the largest value that falls into a bucket */
+		static uint32_t bucket_upper_bound(uint32_t bucket);
+
+		/** Returns the upper bound of the bucket containing the given rank */
+		uint32_t percentile(uint32_t per_mille) const;
+
+		uint32_t _buckets[LATENCY_HISTOGRAM_BUCKETS];
+		uint32_t _count;
+		uint32_t _max;
+
+};
+
+/**
+ * Draw-to-photon latency tracer
+ *
+ * Wraps another DisplayInterface and timestamps the transfers belonging to
+ * a frame tagged by the application with begin_frame()/end_frame().
+ * If the panel's tearing effect (TE) output is connected, the first TE
+ * pulse after the frame completes is taken as the time its pixels were
+ * latched by the panel (eg: ST7789Display::tearing_effect_on(0)).
+ */
+class LatencyTracer : public DisplayInterface
+{
+	public:
+
+		/**
+		 * Instantiate a latency tracer
+		 * @param[in] interface Display interface to trace
+		 * @param[in] te (optional) Tearing effect output from the panel
+		 */
+		LatencyTracer(DisplayInterface& interface, PinName te = NC);
+
+		virtual ~LatencyTracer(void);
+
+		/**
+		 * Marks the start of a frame
+		 * @param[in] id Application-assigned frame ID
+		 * @param[in] start_us Time the frame was initiated (eg: input event),
+		 * taken from us_ticker_read()
+		 */
+		void begin_frame(uint32_t id, uint32_t start_us);
+
+		/**
+		 * Marks that all transfers of the current frame have been written
+		 */
+		void end_frame(void);
+
+		/**
+		 * Attach a callback executed when a frame's timeline is complete
+		 * @note May be called from interrupt context when TE is used
+		 */
+		void attach(mbed::Callback<void(const latency_frame_t&)> cb) {
+			_frame_callback = cb;
+		}
+
+		/**
+		 * Gets the latency percentiles of all completed frames
+		 * @param[out] report Report to fill
+		 */
+		void get_report(latency_report_t& report);
+
+		/**
+		 * Discards all recorded latencies
+		 */
+		void reset(void);
+
+		/**
+		 * Writes a single-byte to the display interface
+		 * @param[in] data Single byte to send to the display interface
+		 * @param[in] is_cmd Is the byte a command (true) or data (false)?
+		 */
+		virtual void write(uint8_t data, bool is_cmd = true);
+
+		/**
+		 * Writes a buffer to the display interface
+		 * @param[in] buffer pointer to buffer of bytes to transmit
+		 * @param[in] num_cmd_bytes Number of command bytes at beginning of buffer
+		 * @param[in] buf_len Total number of bytes in payload buffer
+		 */
+		virtual void write(const uint8_t* buffer, uint32_t num_cmd_bytes, uint32_t buf_len);
+
+		/**
+		 * Writes rows of data spaced by a stride to the display interface
+		 * @param[in] base pointer to the first byte of the first row
+		 * @param[in] stride Distance in bytes between the start of two rows
+		 * @param[in] row_bytes Number of bytes to write from each row
+		 * @param[in] rows Number of rows
+		 */
+		virtual void write_strided(const uint8_t* base, uint32_t stride, uint32_t row_bytes, uint32_t rows);
+
+		/**
+		 * Reads a buffer from the display interface
+		 * @param[out] buffer to fill with data
+		 * @param[in] size Size of buffer
+		 * @retval actual number of bytes read (may always be 0 if unsupported)
+		 */
+		virtual uint8_t read(uint8_t* buffer, uint32_t size) {
+			return _interface.read(buffer, size);
+		}
+
+	private:
+
+		typedef enum {
+			FRAME_IDLE,			/** No frame is being traced */
+			FRAME_ACTIVE,		/** Between begin_frame() and end_frame() */
+			FRAME_WAIT_VSYNC	/** Frame written, waiting for the next TE pulse */
+		} frame_state_t;
+
+		/** Updates the frame timeline before a transfer */
+		void transfer_starting(uint32_t data_bytes);
+
+		/** Updates the frame timeline after a transfer */
+		void transfer_done(void);
+
+		/** Tearing effect interrupt handler */
+		void te_handler(void);
+
+		/**
+		 * Adds the current frame to the histograms
+		 * @note Must be called within a critical section or from the TE interrupt
+		 * @param[out] completed Copy of the committed frame timeline
+		 */
+		void commit_frame(latency_frame_t& completed);
+
+		DisplayInterface& _interface;
+
+		mbed::InterruptIn* _te;
+
+		mbed::Callback<void(const latency_frame_t&)> _frame_callback;
+
+		volatile frame_state_t _state;
+
+		latency_frame_t _frame;
+
+		LatencyHistogram _queue;
+		LatencyHistogram _wait;
+		LatencyHistogram _bus;
+		LatencyHistogram _panel;
+		LatencyHistogram _total;
+
+};
+
+#endif /* UDISPLAY_PLATFORM_LATENCYTRACER_H_ */
@@ -0,0 +1,46 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UDISPLAY_PLATFORM_MIPIDCS_H_
+#define UDISPLAY_PLATFORM_MIPIDCS_H_
+
+/**
+ * MIPI Display Command Set (DCS) commands
+ *
+ * These are shared by most TFT controllers (ST77xx, HX8357, ILI9xxx...)
+ * and are used by code that must address a panel without knowing its driver.
+ */
+#define MIPI_DCS_NOP						0x00
+#define MIPI_DCS_SOFT_RESET					0x01
+#define MIPI_DCS_ENTER_SLEEP_MODE			0x10
+#define MIPI_DCS_EXIT_SLEEP_MODE			0x11
+#define MIPI_DCS_ENTER_NORMAL_MODE			0x13
+#define MIPI_DCS_EXIT_INVERT_MODE			0x20
+#define MIPI_DCS_ENTER_INVERT_MODE			0x21
+#define MIPI_DCS_SET_DISPLAY_OFF			0x28
+#define MIPI_DCS_SET_DISPLAY_ON				0x29
+#define MIPI_DCS_SET_COLUMN_ADDRESS			0x2A	/** CASET */
+#define MIPI_DCS_SET_PAGE_ADDRESS			0x2B	/** RASET/PASET */
+#define MIPI_DCS_WRITE_MEMORY_START			0x2C	/** RAMWR */
+#define MIPI_DCS_SET_TEAR_OFF				0x34
+#define MIPI_DCS_SET_TEAR_ON				0x35
+#define MIPI_DCS_SET_ADDRESS_MODE			0x36	/** MADCTL */
+#define MIPI_DCS_SET_PIXEL_FORMAT			0x3A	/** COLMOD */
+#define MIPI_DCS_WRITE_MEMORY_CONTINUE		0x3C	/** RAMWRC */
+#define MIPI_DCS_SET_TEAR_SCANLINE			0x44
+
+#endif /* UDISPLAY_PLATFORM_MIPIDCS_H_ */
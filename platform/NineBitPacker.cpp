@@ -0,0 +1,74 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "NineBitPacker.h"
+
+uint32_t NineBitPacker::pack(const uint8_t* in, uint32_t count, bool is_data, uint8_t* out) {
+	uint32_t dc = (is_data ? 1 : 0);
+	uint32_t n = 0;
+
+	// Realign on a 9-byte group (at most 7 words)
+	while(count && _bits) {
+		n += push(*in++, dc, out + n);
+		count--;
+	}
+
+	// 8 words -> 9 bytes
+	uint8_t f = (uint8_t) dc;
+	while(count >= 8) {
+		uint8_t* o = out + n;
+		o[0] = (f << 7) | (in[0] >> 1);
+		o[1] = (in[0] << 7) | (f << 6) | (in[1] >> 2);
+		o[2] = (in[1] << 6) | (f << 5) | (in[2] >> 3);
+		o[3] = (in[2] << 5) | (f << 4) | (in[3] >> 4);
+		o[4] = (in[3] << 4) | (f << 3) | (in[4] >> 5);
+		o[5] = (in[4] << 3) | (f << 2) | (in[5] >> 6);
+		o[6] = (in[5] << 2) | (f << 1) | (in[6] >> 7);
+		o[7] = (in[6] << 1) | f;
+		o[8] = in[7];
+		in += 8;
+		count -= 8;
+		n += 9;
+	}
+
+	while(count--) {
+		n += push(*in++, dc, out + n);
+	}
+
+	return n;
+}
+
+uint32_t NineBitPacker::flush(uint8_t* out) {
+	if(_bits == 0) {
+		return 0;
+	}
+	out[0] = (uint8_t) (_acc << (8 - _bits));
+	reset();
+	return 1;
+}
+
+uint32_t NineBitPacker::push(uint8_t byte, uint32_t dc, uint8_t* out) {
+	uint32_t n = 0;
+	_acc = (_acc << 9) | (dc << 8) | byte;
+	_bits += 9;
+	while(_bits >= 8) {
+		_bits -= 8;
+		out[n++] = (uint8_t) (_acc >> _bits);
+	}
+	_acc &= ((1UL << _bits) - 1);
+	return n;
+}
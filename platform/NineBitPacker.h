@@ -0,0 +1,95 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UDISPLAY_PLATFORM_NINEBITPACKER_H_
+#define UDISPLAY_PLATFORM_NINEBITPACKER_H_
+
+#include <stdint.h>
+
+/**
+ * Packs 9-bit 3-wire SPI words into a byte stream
+ *
+ * Each word is a D/C bit (0: command, 1: data) followed by a byte, sent
+ * MSB first. Every 8 words take exactly 9 bytes, so the packed stream can
+ * be sent with ordinary 8-bit SPI frames (and DMA).
+ *
+ * Words are packed 8 at a time with an unrolled kernel whenever the stream
+ * is aligned on a 9-byte group. The packer keeps the bits of an incomplete
+ * byte between calls, so a transaction may be packed in several pieces
+ * (eg: command then data, or one buffer-full at a time).
+ *
+ * This class has no hardware dependencies so it can be tested on a host.
+ */
+class NineBitPacker
+{
+	public:
+
+		NineBitPacker(void) : _acc(0), _bits(0) { }
+
+		/**
+		 * Discards any pending bits and starts a new stream
+		 */
+		void reset(void) {
+			_acc = 0;
+			_bits = 0;
+		}
+
+		/**
+		 * Packs words sharing the same D/C bit
+		 * @param[in] in Bytes to pack, one per word
+		 * @param[in] count Number of words
+		 * @param[in] is_data D/C bit of the words (true for data)
+		 * @param[out] out Packed bytes (at least max_packed_size(count) bytes)
+		 * @retval number of complete bytes written to out
+		 */
+		uint32_t pack(const uint8_t* in, uint32_t count, bool is_data, uint8_t* out);
+
+		/**
+		 * Ends the stream, padding the last incomplete byte with zeros
+		 * @note The display discards the incomplete word when chip select is released
+		 * @param[out] out Last byte, if any
+		 * @retval number of bytes written to out (0 or 1)
+		 */
+		uint32_t flush(uint8_t* out);
+
+		/**
+		 * Gets the number of bits waiting for a complete byte (0 to 7)
+		 */
+		uint32_t pending_bits(void) const {
+			return _bits;
+		}
+
+		/**
+		 * Gets the largest number of bytes pack() may write for a number of words
+		 */
+		static uint32_t max_packed_size(uint32_t count) {
+			return ((count * 9) + 7) / 8;
+		}
+
+	private:
+
+		/** Packs a single word through the bit accumulator */
+		uint32_t push(uint8_t byte, uint32_t dc, uint8_t* out);
+
+		/** Bits of the incomplete byte, right aligned */
+		uint32_t _acc;
+
+		uint32_t _bits;
+
+};
+
+#endif /* UDISPLAY_PLATFORM_NINEBITPACKER_H_ */
@@ -0,0 +1,98 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RecordingInterface.h"
+
+#include "hal/us_ticker_api.h"
+
+RecordingInterface::RecordingInterface(FILE* stream, DisplayInterface* interface) :
+		_stream(stream), _interface(interface), _last_us(0), _records(0),
+		_started(false), _error(false) {
+	if(fwrite(RECORDING_MAGIC, 1, RECORDING_MAGIC_LENGTH, _stream) != RECORDING_MAGIC_LENGTH) {
+		_error = true;
+	}
+}
+
+void RecordingInterface::write(uint8_t data, bool is_cmd) {
+	record(&data, (is_cmd ? 1 : 0), 1);
+	if(_interface) {
+		_interface->write(data, is_cmd);
+	}
+	_stats.record_transaction((is_cmd ? 1 : 0), 1, 0);
+}
+
+void RecordingInterface::write(const uint8_t* buffer, uint32_t num_cmd_bytes, uint32_t buf_len) {
+	record(buffer, num_cmd_bytes, buf_len);
+	if(_interface) {
+		_interface->write(buffer, num_cmd_bytes, buf_len);
+	}
+	_stats.record_transaction(num_cmd_bytes, buf_len, 0);
+}
+
+uint8_t RecordingInterface::read(uint8_t* buffer, uint32_t size) {
+	if(_interface) {
+		return _interface->read(buffer, size);
+	}
+	return 0;
+}
+
+void RecordingInterface::flush(void) {
+	if(fflush(_stream) != 0) {
+		_error = true;
+	}
+}
+
+void RecordingInterface::record(const uint8_t* buffer, uint32_t num_cmd_bytes, uint32_t buf_len) {
+	if(_error) {
+		return;
+	}
+
+	// The first record is at time 0
+	uint32_t now = us_ticker_read();
+	if(!_started) {
+		_last_us = now;
+		_started = true;
+	}
+
+	uint8_t header[15];
+	uint32_t header_len = 0;
+	header_len += encode_varint(&header[header_len], now - _last_us);
+	header_len += encode_varint(&header[header_len], num_cmd_bytes);
+	header_len += encode_varint(&header[header_len], buf_len);
+	_last_us = now;
+
+	if(fwrite(header, 1, header_len, _stream) != header_len ||
+			fwrite(buffer, 1, buf_len, _stream) != buf_len) {
+		_error = true;
+		return;
+	}
+
+	_records++;
+}
+
+uint32_t RecordingInterface::encode_varint(uint8_t* out, uint32_t value) {
+	uint32_t len = 0;
+	do {
+		uint8_t byte = (value & 0x7F);
+		value >>= 7;
+		if(value) {
+			byte |= 0x80;
+		}
+		out[len++] = byte;
+	} while(value);
+	return len;
+}
@@ -0,0 +1,128 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UDISPLAY_PLATFORM_RECORDINGINTERFACE_H_
+#define UDISPLAY_PLATFORM_RECORDINGINTERFACE_H_
+
+#include <stdio.h>
+
+#include "DisplayInterface.h"
+
+/**
+ * Command stream recording file format
+ *
+ * The file starts with the 4-byte magic "UDR1" followed by one record per
+ * transaction:
+ * - delta: time since the previous record started (microseconds, varint)
+ * - num_cmd_bytes: number of command bytes (varint)
+ * - length: total number of bytes (varint)
+ * - payload: length bytes
+ *
+ * Varints are unsigned LEB128 (7 bits per byte, least significant first)
+ */
+#define RECORDING_MAGIC				"UDR1"
+#define RECORDING_MAGIC_LENGTH		4
+
+/**
+ * Recording DisplayInterface decorator
+ *
+ * Captures the exact byte stream written to a display (with the
+ * command/data split and timestamps) into a file so it can be replayed
+ * later with StreamReplayer, eg: on a workstation against an emulator.
+ *
+ * Transactions are forwarded to the wrapped interface, if any.
+ */
+class RecordingInterface : public DisplayInterface
+{
+	public:
+
+		/**
+		 * Instantiate a recording interface
+		 * @param[in] stream Open, writable stream to record into
+		 * @param[in] interface (optional) Display interface to forward transactions to
+		 */
+		RecordingInterface(FILE* stream, DisplayInterface* interface = NULL);
+
+		virtual ~RecordingInterface(void) { }
+
+		/**
+		 * Writes a single-byte to the display interface
+		 * @param[in] data Single byte to send to the display interface
+		 * @param[in] is_cmd Is the byte a command (true) or data (false)?
+		 */
+		virtual void write(uint8_t data, bool is_cmd = true);
+
+		/**
+		 * Writes a buffer to the display interface
+		 * @param[in] buffer pointer to buffer of bytes to transmit
+		 * @param[in] num_cmd_bytes Number of command bytes at beginning of buffer
+		 * @param[in] buf_len Total number of bytes in payload buffer
+		 */
+		virtual void write(const uint8_t* buffer, uint32_t num_cmd_bytes, uint32_t buf_len);
+
+		/**
+		 * Reads a buffer from the display interface
+		 * @note Reads are forwarded but not recorded
+		 * @param[out] buffer to fill with data
+		 * @param[in] size Size of buffer
+		 * @retval actual number of bytes read (may always be 0 if unsupported)
+		 */
+		virtual uint8_t read(uint8_t* buffer, uint32_t size);
+
+		/**
+		 * Flushes buffered recording data to the stream
+		 */
+		void flush(void);
+
+		/**
+		 * Gets the number of transactions recorded so far
+		 */
+		uint32_t records(void) const {
+			return _records;
+		}
+
+		/**
+		 * Indicates if writing to the stream has failed
+		 */
+		bool error(void) const {
+			return _error;
+		}
+
+	private:
+
+		/** Appends a record header and payload to the stream */
+		void record(const uint8_t* buffer, uint32_t num_cmd_bytes, uint32_t buf_len);
+
+		/** Encodes a varint into the given buffer, returns the number of bytes used */
+		static uint32_t encode_varint(uint8_t* out, uint32_t value);
+
+		FILE* _stream;
+
+		DisplayInterface* _interface;
+
+		/** Start time of the previous record */
+		uint32_t _last_us;
+
+		uint32_t _records;
+
+		bool _started;
+
+		bool _error;
+
+};
+
+#endif /* UDISPLAY_PLATFORM_RECORDINGINTERFACE_H_ */
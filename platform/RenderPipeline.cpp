@@ -0,0 +1,187 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RenderPipeline.h"
+
+#include <string.h>
+
+#include "platform/mbed_assert.h"
+#include "hal/us_ticker_api.h"
+
+#define PIPELINE_IDLE_FLAG 0x1
+
+RenderPipeline::RenderPipeline(DisplayInterface& interface, uint8_t* const* buffers,
+		uint32_t buffer_count, osPriority priority) :
+		_interface(interface), _count(buffer_count),
+		_free_head(0), _free_tail(0), _ready_head(0), _ready_tail(0),
+		_free_sem(buffer_count), _ready_sem(0), _mutex(), _idle_evt(), _pending(0), _running(false),
+		_thread(priority, RENDER_PIPELINE_STACK_SIZE, NULL, "display_tx") {
+
+	MBED_ASSERT(buffer_count > 0);
+
+	// Index rings have a spare entry so a full ring can be told apart from an empty one
+	_slots = new frame_slot_t[buffer_count];
+	_free = new uint32_t[buffer_count + 1];
+	_ready = new uint32_t[buffer_count + 1];
+
+	// All buffers start out free
+	for(uint32_t i = 0; i < buffer_count; i++) {
+		_slots[i].buffer = buffers[i];
+		_slots[i].num_cmd_bytes = 0;
+		_slots[i].length = 0;
+		_slots[i].acquired_us = 0;
+		push(_free, _free_tail, i);
+	}
+
+	memset(&_stats, 0, sizeof(_stats));
+	_idle_evt.set(PIPELINE_IDLE_FLAG);
+}
+
+RenderPipeline::~RenderPipeline(void) {
+	stop();
+	delete[] _slots;
+	delete[] _free;
+	delete[] _ready;
+}
+
+void RenderPipeline::start(void) {
+	if(_running) {
+		return;
+	}
+	_running = true;
+	_thread.start(mbed::callback(this, &RenderPipeline::transmit_task));
+}
+
+void RenderPipeline::stop(void) {
+	if(!_running) {
+		return;
+	}
+	flush();
+	_running = false;
+
+	// Wake up the transmit thread so it sees it has been stopped
+	_ready_sem.release();
+	_thread.join();
+}
+
+uint8_t* RenderPipeline::acquire(uint32_t timeout_ms) {
+	uint32_t start = us_ticker_read();
+	if(_free_sem.wait(timeout_ms) <= 0) {
+		return NULL;
+	}
+	uint32_t now = us_ticker_read();
+
+	_mutex.lock();
+	uint32_t slot = pop(_free, _free_head);
+	_slots[slot].acquired_us = now;
+	_stats.backpressure_us += (now - start);
+	_mutex.unlock();
+
+	return _slots[slot].buffer;
+}
+
+void RenderPipeline::submit(uint8_t* buffer, uint32_t num_cmd_bytes, uint32_t length,
+		prologue_t prologue) {
+
+	uint32_t slot;
+	for(slot = 0; slot < _count; slot++) {
+		if(_slots[slot].buffer == buffer) {
+			break;
+		}
+	}
+	MBED_ASSERT(slot < _count);
+
+	uint32_t render_us = us_ticker_read() - _slots[slot].acquired_us;
+	_slots[slot].num_cmd_bytes = num_cmd_bytes;
+	_slots[slot].length = length;
+	_slots[slot].prologue = prologue;
+
+	_mutex.lock();
+	_stats.render_us += render_us;
+	if(render_us > _stats.max_render_us) {
+		_stats.max_render_us = render_us;
+	}
+	push(_ready, _ready_tail, slot);
+	_pending++;
+	_idle_evt.clear(PIPELINE_IDLE_FLAG);
+	_mutex.unlock();
+
+	_ready_sem.release();
+}
+
+void RenderPipeline::flush(void) {
+	_idle_evt.wait_any(PIPELINE_IDLE_FLAG, osWaitForever, false);
+}
+
+void RenderPipeline::get_stats(render_pipeline_stats_t& stats) {
+	_mutex.lock();
+	stats = _stats;
+	_mutex.unlock();
+}
+
+void RenderPipeline::transmit_task(void) {
+	while(true) {
+		uint32_t wait_start = us_ticker_read();
+		_ready_sem.wait(osWaitForever);
+
+		_mutex.lock();
+		bool has_frame = (_ready_head != _ready_tail);
+		uint32_t slot = has_frame ? pop(_ready, _ready_head) : 0;
+		_mutex.unlock();
+
+		if(!has_frame) {
+			if(!_running) {
+				return;
+			}
+			continue;
+		}
+
+		uint32_t start = us_ticker_read();
+		frame_slot_t& frame = _slots[slot];
+		if(frame.prologue) {
+			frame.prologue(_interface);
+		}
+		_interface.write(frame.buffer, frame.num_cmd_bytes, frame.length);
+		uint32_t end = us_ticker_read();
+
+		_mutex.lock();
+		_stats.frames++;
+		_stats.idle_us += (start - wait_start);
+		_stats.transmit_us += (end - start);
+		if((end - start) > _stats.max_transmit_us) {
+			_stats.max_transmit_us = (end - start);
+		}
+		push(_free, _free_tail, slot);
+		if(--_pending == 0) {
+			_idle_evt.set(PIPELINE_IDLE_FLAG);
+		}
+		_mutex.unlock();
+
+		_free_sem.release();
+	}
+}
+
+void RenderPipeline::push(uint32_t* ring, uint32_t& tail, uint32_t slot) {
+	ring[tail] = slot;
+	tail = (tail + 1) % (_count + 1);
+}
+
+uint32_t RenderPipeline::pop(uint32_t* ring, uint32_t& head) {
+	uint32_t slot = ring[head];
+	head = (head + 1) % (_count + 1);
+	return slot;
+}
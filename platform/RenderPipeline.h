@@ -0,0 +1,172 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UDISPLAY_PLATFORM_RENDERPIPELINE_H_
+#define UDISPLAY_PLATFORM_RENDERPIPELINE_H_
+
+#include "DisplayInterface.h"
+
+#include "platform/Callback.h"
+#include "rtos/Thread.h"
+#include "rtos/Semaphore.h"
+#include "rtos/Mutex.h"
+#include "rtos/EventFlags.h"
+
+/** Stack size of the transmit thread */
+#ifndef RENDER_PIPELINE_STACK_SIZE
+#define RENDER_PIPELINE_STACK_SIZE 1024
+#endif
+
+/**
+ * Render/transmit pipeline statistics (times in microseconds)
+ */
+typedef struct {
+	uint32_t frames;				/** Frames transmitted */
+	uint64_t render_us;				/** Total time between acquire() and submit() */
+	uint32_t max_render_us;			/** Longest render */
+	uint64_t transmit_us;			/** Total time spent transmitting */
+	uint32_t max_transmit_us;		/** Longest transmit */
+	uint64_t backpressure_us;		/** Total time acquire() blocked waiting for a free buffer */
+	uint64_t idle_us;				/** Total time the transmit stage waited for a frame */
+} render_pipeline_stats_t;
+
+/**
+ * Double (or N-) buffered render/transmit pipeline
+ *
+ * The render stage acquires a free buffer, fills it and submits it.
+ * A dedicated transmit thread pushes submitted buffers through the
+ * DisplayInterface in order and returns them to the free pool, so
+ * rendering buffer N overlaps with transmitting buffer N-1.
+ *
+ * When all buffers are in flight, acquire() blocks (backpressure).
+ *
+ * @note The interface must only be used by the pipeline while it is running
+ */
+class RenderPipeline
+{
+	public:
+
+		/**
+		 * Executed by the transmit thread before a frame is written,
+		 * eg: to set the panel's address window
+		 */
+		typedef mbed::Callback<void(DisplayInterface&)> prologue_t;
+
+		/**
+		 * Instantiate a render pipeline
+		 * @param[in] interface Display interface frames are transmitted through
+		 * @param[in] buffers Array of frame buffers
+		 * @param[in] buffer_count Number of frame buffers (2 for double buffering)
+		 * @param[in] priority Priority of the transmit thread
+		 */
+		RenderPipeline(DisplayInterface& interface, uint8_t* const* buffers,
+				uint32_t buffer_count, osPriority priority = osPriorityAboveNormal);
+
+		virtual ~RenderPipeline(void);
+
+		/**
+		 * Starts the transmit thread
+		 * @note The pipeline can only be started once
+		 */
+		void start(void);
+
+		/**
+		 * Transmits all submitted frames and stops the transmit thread
+		 */
+		void stop(void);
+
+		/**
+		 * Gets a free buffer to render into
+		 * @param[in] timeout_ms Maximum time to wait for a buffer
+		 * @retval buffer to render into, or NULL on timeout
+		 */
+		uint8_t* acquire(uint32_t timeout_ms = osWaitForever);
+
+		/**
+		 * Submits a rendered buffer for transmission
+		 * @param[in] buffer Buffer returned by acquire()
+		 * @param[in] num_cmd_bytes Number of command bytes at beginning of buffer
+		 * @param[in] length Total number of bytes to transmit
+		 * @param[in] prologue (optional) Executed by the transmit thread before the buffer is written
+		 */
+		void submit(uint8_t* buffer, uint32_t num_cmd_bytes, uint32_t length,
+				prologue_t prologue = NULL);
+
+		/**
+		 * Blocks until every submitted frame has been transmitted
+		 */
+		void flush(void);
+
+		/**
+		 * Gets the pipeline statistics
+		 * @param[out] stats Snapshot to fill
+		 */
+		void get_stats(render_pipeline_stats_t& stats);
+
+	private:
+
+		typedef struct {
+			uint8_t* buffer;
+			uint32_t num_cmd_bytes;
+			uint32_t length;
+			prologue_t prologue;
+			uint32_t acquired_us;
+		} frame_slot_t;
+
+		/** Transmit thread main loop */
+		void transmit_task(void);
+
+		/** Pushes a slot index onto one of the index rings */
+		void push(uint32_t* ring, uint32_t& tail, uint32_t slot);
+
+		/** Pops a slot index off one of the index rings */
+		uint32_t pop(uint32_t* ring, uint32_t& head);
+
+		DisplayInterface& _interface;
+
+		frame_slot_t* _slots;
+
+		uint32_t _count;
+
+		/** Free and ready slot index rings */
+		uint32_t* _free;
+		uint32_t _free_head, _free_tail;
+		uint32_t* _ready;
+		uint32_t _ready_head, _ready_tail;
+
+		rtos::Semaphore _free_sem;
+
+		rtos::Semaphore _ready_sem;
+
+		/** Protects the index rings, pending count and statistics */
+		rtos::Mutex _mutex;
+
+		/** Set when no submitted frames are left to transmit */
+		rtos::EventFlags _idle_evt;
+
+		/** Number of frames submitted but not yet transmitted */
+		volatile uint32_t _pending;
+
+		volatile bool _running;
+
+		rtos::Thread _thread;
+
+		render_pipeline_stats_t _stats;
+
+};
+
+#endif /* UDISPLAY_PLATFORM_RENDERPIPELINE_H_ */
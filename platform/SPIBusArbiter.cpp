@@ -0,0 +1,141 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SPIBusArbiter.h"
+
+#if defined(DEVICE_SPI)
+
+#include <string.h>
+
+#include "platform/mbed_assert.h"
+#include "hal/us_ticker_api.h"
+
+SPIBusArbiter::SPIBusArbiter(mbed::SPI& spi) : _spi(spi), _num_clients(0),
+		_owner(SPI_ARBITER_INVALID_CLIENT), _stats_start(us_ticker_read()),
+		_mutex(), _released(_mutex) {
+	memset(_clients, 0, sizeof(_clients));
+}
+
+SPIBusArbiter::client_id_t SPIBusArbiter::add_client(uint8_t priority, uint32_t slice_us) {
+	_mutex.lock();
+	if(_num_clients == SPI_ARBITER_MAX_CLIENTS) {
+		_mutex.unlock();
+		return SPI_ARBITER_INVALID_CLIENT;
+	}
+	client_id_t id = _num_clients++;
+	_clients[id].priority = priority;
+	_clients[id].slice_us = slice_us;
+	_mutex.unlock();
+	return id;
+}
+
+void SPIBusArbiter::acquire(client_id_t client) {
+	MBED_ASSERT(client >= 0 && (uint32_t) client < _num_clients);
+	client_t& c = _clients[client];
+
+	_mutex.lock();
+	c.waiting = true;
+	c.wait_start = us_ticker_read();
+	while(_owner != SPI_ARBITER_INVALID_CLIENT || !is_next(client)) {
+		_released.wait();
+	}
+	_owner = client;
+	c.waiting = false;
+	c.grant_start = us_ticker_read();
+
+	uint32_t waited = c.grant_start - c.wait_start;
+	c.stats.grants++;
+	c.stats.wait_us += waited;
+	if(waited > c.stats.max_wait_us) {
+		c.stats.max_wait_us = waited;
+	}
+	_mutex.unlock();
+
+	// Keep drivers that don't use the arbiter off the bus too
+	_spi.lock();
+}
+
+void SPIBusArbiter::release(client_id_t client) {
+	MBED_ASSERT(client == _owner);
+
+	_spi.unlock();
+
+	_mutex.lock();
+	_clients[client].stats.busy_us += (us_ticker_read() - _clients[client].grant_start);
+	_owner = SPI_ARBITER_INVALID_CLIENT;
+	_released.notify_all();
+	_mutex.unlock();
+}
+
+bool SPIBusArbiter::should_yield(client_id_t client) {
+	bool yield = false;
+
+	_mutex.lock();
+	const client_t& c = _clients[client];
+	bool slice_expired = ((us_ticker_read() - c.grant_start) >= c.slice_us);
+	for(uint32_t i = 0; i < _num_clients; i++) {
+		if(!_clients[i].waiting) {
+			continue;
+		}
+		if(_clients[i].priority > c.priority || slice_expired) {
+			yield = true;
+			break;
+		}
+	}
+	_mutex.unlock();
+
+	return yield;
+}
+
+void SPIBusArbiter::get_stats(client_id_t client, spi_arbiter_client_stats_t& stats) {
+	_mutex.lock();
+	stats = _clients[client].stats;
+	uint32_t elapsed = us_ticker_read() - _stats_start;
+	if(elapsed) {
+		stats.utilization_permille = (uint32_t) ((stats.busy_us * 1000) / elapsed);
+	}
+	_mutex.unlock();
+}
+
+void SPIBusArbiter::reset_stats(void) {
+	_mutex.lock();
+	for(uint32_t i = 0; i < _num_clients; i++) {
+		memset(&_clients[i].stats, 0, sizeof(_clients[i].stats));
+	}
+	_stats_start = us_ticker_read();
+	_mutex.unlock();
+}
+
+bool SPIBusArbiter::is_next(client_id_t client) {
+	const client_t& c = _clients[client];
+	for(uint32_t i = 0; i < _num_clients; i++) {
+		const client_t& other = _clients[i];
+		if((client_id_t) i == client || !other.waiting) {
+			continue;
+		}
+		if(other.priority > c.priority) {
+			return false;
+		}
+		// Oldest waiter first among equal priorities
+		if(other.priority == c.priority && (int32_t) (other.wait_start - c.wait_start) < 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+#endif
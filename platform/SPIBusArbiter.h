@@ -0,0 +1,161 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UDISPLAY_PLATFORM_SPIBUSARBITER_H_
+#define UDISPLAY_PLATFORM_SPIBUSARBITER_H_
+
+#include <stdint.h>
+
+#include "drivers/SPI.h"
+#include "rtos/Mutex.h"
+#include "rtos/ConditionVariable.h"
+
+#if defined(DEVICE_SPI)
+
+/** Maximum number of clients sharing a bus */
+#ifndef SPI_ARBITER_MAX_CLIENTS
+#define SPI_ARBITER_MAX_CLIENTS 4
+#endif
+
+/** Returned by add_client() when no more clients can be added */
+#define SPI_ARBITER_INVALID_CLIENT -1
+
+/**
+ * Per-client bus statistics (times in microseconds)
+ */
+typedef struct {
+	uint32_t grants;				/** Number of times the bus was granted */
+	uint64_t busy_us;				/** Total time the client held the bus */
+	uint64_t wait_us;				/** Total time the client waited for the bus */
+	uint32_t max_wait_us;			/** Longest wait for the bus */
+	uint32_t utilization_permille;	/** Share of time the client held the bus since the last reset */
+} spi_arbiter_client_stats_t;
+
+/**
+ * Priority arbiter for a shared SPI bus
+ *
+ * Every device on the bus (display, flash, sensors...) is registered as a
+ * client with a priority and a time slice. Clients acquire the bus before
+ * using it and release it afterwards. When the bus is released, it is
+ * granted to the highest priority waiting client (oldest first among
+ * equal priorities).
+ *
+ * A client holding the bus for a batch of transactions (eg: a display
+ * drawing a frame) should check should_yield() between transactions and
+ * release the bus when it returns true: either a higher priority client is
+ * waiting, or its time slice has expired and another client is waiting.
+ *
+ * The SPI bus is locked while a client holds it, so drivers that don't go
+ * through the arbiter still get mutual exclusion.
+ *
+ * @note Thread safe, not ISR safe
+ */
+class SPIBusArbiter
+{
+	public:
+
+		typedef int client_id_t;
+
+		/**
+		 * Instantiate a bus arbiter
+		 * @param[in] spi Shared SPI bus
+		 */
+		SPIBusArbiter(mbed::SPI& spi);
+
+		virtual ~SPIBusArbiter(void) { }
+
+		/**
+		 * Gets the SPI bus the arbiter controls
+		 * @retval shared SPI bus
+		 */
+		mbed::SPI& spi(void) {
+			return _spi;
+		}
+
+		/**
+		 * Registers a client
+		 * @param[in] priority Client priority (higher values win)
+		 * @param[in] slice_us Maximum time the client holds the bus while others wait
+		 * @retval client ID, or SPI_ARBITER_INVALID_CLIENT if too many clients were added
+		 */
+		client_id_t add_client(uint8_t priority, uint32_t slice_us);
+
+		/**
+		 * Blocks until the bus is granted to a client
+		 * @param[in] client Client ID
+		 */
+		void acquire(client_id_t client);
+
+		/**
+		 * Releases the bus
+		 * @param[in] client Client ID, must currently hold the bus
+		 */
+		void release(client_id_t client);
+
+		/**
+		 * Checks if the client holding the bus should release it
+		 * @param[in] client Client ID, must currently hold the bus
+		 * @retval true if another client should be given the bus
+		 */
+		bool should_yield(client_id_t client);
+
+		/**
+		 * Gets a client's statistics
+		 * @param[in] client Client ID
+		 * @param[out] stats Snapshot to fill
+		 */
+		void get_stats(client_id_t client, spi_arbiter_client_stats_t& stats);
+
+		/**
+		 * Resets every client's statistics
+		 */
+		void reset_stats(void);
+
+	private:
+
+		typedef struct {
+			uint8_t priority;
+			uint32_t slice_us;
+			bool waiting;
+			uint32_t wait_start;
+			uint32_t grant_start;
+			spi_arbiter_client_stats_t stats;
+		} client_t;
+
+		/** Checks if a client is the one the bus should be granted to next */
+		bool is_next(client_id_t client);
+
+		mbed::SPI& _spi;
+
+		client_t _clients[SPI_ARBITER_MAX_CLIENTS];
+
+		uint32_t _num_clients;
+
+		/** Client holding the bus */
+		client_id_t _owner;
+
+		uint32_t _stats_start;
+
+		rtos::Mutex _mutex;
+
+		rtos::ConditionVariable _released;
+
+};
+
+#endif
+
+#endif /* UDISPLAY_PLATFORM_SPIBUSARBITER_H_ */
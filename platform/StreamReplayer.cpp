@@ -0,0 +1,121 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "StreamReplayer.h"
+
+#include <string.h>
+
+StreamReplayer::StreamReplayer(FILE* stream, uint8_t* scratch, uint32_t scratch_size) :
+		_stream(stream), _scratch(scratch), _scratch_size(scratch_size),
+		_clock(NULL), _delay(NULL), _record_time(0), _replay_start(0), _started(false) {
+}
+
+int32_t StreamReplayer::replay(DisplayInterface& target) {
+	int32_t count = 0;
+	int32_t result;
+	while((result = replay_next(target)) > 0) {
+		count++;
+	}
+	return (result < 0) ? result : count;
+}
+
+int32_t StreamReplayer::replay_next(DisplayInterface& target) {
+
+	if(_scratch == NULL || _scratch_size == 0) {
+		return REPLAY_ERROR_SCRATCH;
+	}
+
+	if(!_started) {
+		int32_t result = read_magic();
+		if(result <= 0) {
+			return result;
+		}
+		_started = true;
+		_record_time = 0;
+		_replay_start = (_clock ? _clock() : 0);
+	}
+
+	uint32_t delta, num_cmd_bytes, length;
+	int32_t result = read_varint(delta);
+	if(result <= 0) {
+		return result;
+	}
+	if(read_varint(num_cmd_bytes) <= 0 || read_varint(length) <= 0) {
+		return REPLAY_ERROR_TRUNCATED;
+	}
+	if(num_cmd_bytes > length || (num_cmd_bytes > _scratch_size)) {
+		return REPLAY_ERROR_FORMAT;
+	}
+
+	// Wait until the record's original offset from the start of the recording
+	_record_time += delta;
+	if(_clock && _delay) {
+		uint32_t elapsed = _clock() - _replay_start;
+		if((int32_t)(_record_time - elapsed) > 0) {
+			_delay(_record_time - elapsed);
+		}
+	}
+
+	// Records larger than the scratch buffer are split into data continuations
+	uint32_t remaining = length;
+	uint32_t cmd_bytes = num_cmd_bytes;
+	do {
+		uint32_t chunk = (remaining < _scratch_size) ? remaining : _scratch_size;
+		if(fread(_scratch, 1, chunk, _stream) != chunk) {
+			return REPLAY_ERROR_TRUNCATED;
+		}
+
+		if(chunk == 1) {
+			target.write(_scratch[0], (cmd_bytes != 0));
+		} else {
+			target.write(_scratch, cmd_bytes, chunk);
+		}
+
+		remaining -= chunk;
+		cmd_bytes = 0;
+	} while(remaining);
+
+	return 1;
+}
+
+int32_t StreamReplayer::read_magic(void) {
+	char magic[RECORDING_MAGIC_LENGTH];
+	size_t len = fread(magic, 1, RECORDING_MAGIC_LENGTH, _stream);
+	if(len == 0) {
+		return 0;
+	}
+	if(len != RECORDING_MAGIC_LENGTH || memcmp(magic, RECORDING_MAGIC, RECORDING_MAGIC_LENGTH) != 0) {
+		return REPLAY_ERROR_FORMAT;
+	}
+	return 1;
+}
+
+int32_t StreamReplayer::read_varint(uint32_t& value) {
+	value = 0;
+	for(uint32_t shift = 0; shift < 35; shift += 7) {
+		int c = fgetc(_stream);
+		if(c == EOF) {
+			// End of stream is only valid before the first byte of a varint
+			return (shift == 0) ? 0 : REPLAY_ERROR_TRUNCATED;
+		}
+		value |= ((uint32_t)(c & 0x7F) << shift);
+		if(!(c & 0x80)) {
+			return 1;
+		}
+	}
+	return REPLAY_ERROR_FORMAT;
+}
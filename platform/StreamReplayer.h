@@ -0,0 +1,114 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UDISPLAY_PLATFORM_STREAMREPLAYER_H_
+#define UDISPLAY_PLATFORM_STREAMREPLAYER_H_
+
+#include <stdio.h>
+
+#include "DisplayInterface.h"
+#include "RecordingInterface.h"
+
+/** Replay error codes */
+#define REPLAY_ERROR_FORMAT		-1	/** Stream is not a recording or is corrupt */
+#define REPLAY_ERROR_TRUNCATED	-2	/** Stream ended in the middle of a record */
+#define REPLAY_ERROR_SCRATCH	-3	/** No scratch buffer was given */
+
+/**
+ * Replays a command stream captured by RecordingInterface
+ *
+ * Only depends on DisplayInterface and the C standard library, so it can
+ * be built into a workstation tool along with an emulated DisplayInterface
+ * (see tools/replay.cpp).
+ */
+class StreamReplayer
+{
+	public:
+
+		/** Returns the current time in microseconds */
+		typedef uint32_t (*clock_fn_t)(void);
+
+		/** Blocks for the given number of microseconds */
+		typedef void (*delay_fn_t)(uint32_t us);
+
+		/**
+		 * Instantiate a stream replayer
+		 * @param[in] stream Open, readable stream positioned at the start of a recording
+		 * @param[in] scratch Buffer used to hold record payloads
+		 * @param[in] scratch_size Size of the scratch buffer, must not be 0.
+		 * Larger records are split into several writes.
+		 */
+		StreamReplayer(FILE* stream, uint8_t* scratch, uint32_t scratch_size);
+
+		/**
+		 * Reproduce the original timing between transactions while replaying
+		 * @param[in] clock Time source
+		 * @param[in] delay Delay function
+		 * @note Without pacing, records are replayed at full speed
+		 */
+		void set_pacing(clock_fn_t clock, delay_fn_t delay) {
+			_clock = clock;
+			_delay = delay;
+		}
+
+		/**
+		 * Replays every record in the stream into the target interface
+		 * @param[in] target Interface to replay into
+		 * @retval number of records replayed, or a negative REPLAY_ERROR_* code
+		 */
+		int32_t replay(DisplayInterface& target);
+
+		/**
+		 * Replays the next record into the target interface
+		 * @param[in] target Interface to replay into
+		 * @retval 1 if a record was replayed, 0 at the end of the stream,
+		 * or a negative REPLAY_ERROR_* code
+		 */
+		int32_t replay_next(DisplayInterface& target);
+
+	private:
+
+		/** Checks the stream magic, only done once */
+		int32_t read_magic(void);
+
+		/**
+		 * Reads a varint from the stream
+		 * @retval 1 on success, 0 at end of stream, or a REPLAY_ERROR_* code
+		 */
+		int32_t read_varint(uint32_t& value);
+
+		FILE* _stream;
+
+		uint8_t* _scratch;
+
+		uint32_t _scratch_size;
+
+		clock_fn_t _clock;
+
+		delay_fn_t _delay;
+
+		/** Recording time of the last replayed record, relative to the first */
+		uint32_t _record_time;
+
+		/** Clock value when replay started */
+		uint32_t _replay_start;
+
+		bool _started;
+
+};
+
+#endif /* UDISPLAY_PLATFORM_STREAMREPLAYER_H_ */
@@ -0,0 +1,243 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "WindowScheduler.h"
+#include "MIPIDCS.h"
+
+#include <string.h>
+
+#include "hal/us_ticker_api.h"
+
+#define SCHEDULER_WORK_FLAG 0x1
+#define SCHEDULER_IDLE_FLAG 0x2
+
+WindowScheduler::WindowScheduler(DisplayInterface& interface, uint32_t chunk_bytes,
+		osPriority priority) : _interface(interface), _chunk_bytes(chunk_bytes),
+		_mutex(), _evt(), _pending(0), _running(false),
+		_thread(priority, WINDOW_SCHEDULER_STACK_SIZE, NULL, "display_sched") {
+
+	_urgent.capacity = WINDOW_SCHEDULER_URGENT_SLOTS;
+	_urgent.head = 0;
+	_urgent.count = 0;
+	_background.capacity = WINDOW_SCHEDULER_BACKGROUND_SLOTS;
+	_background.head = 0;
+	_background.count = 0;
+
+	memset(&_stats, 0, sizeof(_stats));
+	_evt.set(SCHEDULER_IDLE_FLAG);
+}
+
+WindowScheduler::~WindowScheduler(void) {
+	stop();
+}
+
+void WindowScheduler::start(void) {
+	if(_running) {
+		return;
+	}
+	_running = true;
+	_thread.start(mbed::callback(this, &WindowScheduler::schedule_task));
+}
+
+void WindowScheduler::stop(void) {
+	if(!_running) {
+		return;
+	}
+	flush();
+	_running = false;
+
+	// Wake up the scheduler thread so it sees it has been stopped
+	_evt.set(SCHEDULER_WORK_FLAG);
+	_thread.join();
+}
+
+bool WindowScheduler::write_window(const display_rect_t& rect, const uint8_t* pixels,
+		uint32_t bytes_per_pixel, priority_t priority, done_t done) {
+
+	// The scheduler divides by the row size, empty windows are rejected up front
+	if(bytes_per_pixel == 0 || pixels == NULL || rect.x1 < rect.x0 || rect.y1 < rect.y0) {
+		return false;
+	}
+
+	job_queue_t& queue = (priority == PRIORITY_URGENT) ? _urgent : _background;
+
+	_mutex.lock();
+	if(queue.count == queue.capacity) {
+		_mutex.unlock();
+		return false;
+	}
+
+	window_job_t& job = queue.jobs[(queue.head + queue.count) % queue.capacity];
+	job.rect = rect;
+	job.pixels = pixels;
+	job.bytes_per_pixel = bytes_per_pixel;
+	job.done = done;
+	job.posted_us = us_ticker_read();
+	queue.count++;
+	_pending++;
+	_evt.clear(SCHEDULER_IDLE_FLAG);
+	_mutex.unlock();
+
+	_evt.set(SCHEDULER_WORK_FLAG);
+	return true;
+}
+
+void WindowScheduler::flush(void) {
+	_evt.wait_any(SCHEDULER_IDLE_FLAG, osWaitForever, false);
+}
+
+void WindowScheduler::get_stats(window_scheduler_stats_t& stats) {
+	_mutex.lock();
+	stats = _stats;
+	_mutex.unlock();
+}
+
+void WindowScheduler::schedule_task(void) {
+	window_job_t current;
+	bool active = false;		// A background window is in progress
+	bool resume = false;		// The address window must be set again before the next chunk
+	uint32_t next_row = 0;		// Next row of the background window to send
+	uint32_t completed;
+
+	while(true) {
+		_evt.wait_any(SCHEDULER_WORK_FLAG);
+
+		while(true) {
+			completed = 0;
+
+			// Urgent windows go out in full as soon as the bus is between chunks
+			window_job_t urgent;
+			_mutex.lock();
+			bool has_urgent = pop(_urgent, urgent);
+			_mutex.unlock();
+
+			if(has_urgent) {
+				uint32_t latency = us_ticker_read() - urgent.posted_us;
+				const display_rect_t& r = urgent.rect;
+				set_window(r.x0, r.y0, r.x1, r.y1);
+				_interface.write(MIPI_DCS_WRITE_MEMORY_START);
+				_interface.write(urgent.pixels, 0,
+						(r.x1 - r.x0 + 1) * (r.y1 - r.y0 + 1) * urgent.bytes_per_pixel);
+
+				if(urgent.done) {
+					urgent.done();
+				}
+
+				_mutex.lock();
+				_stats.urgent_writes++;
+				if(active) {
+					_stats.preemptions++;
+				}
+				if(latency > _stats.max_urgent_latency_us) {
+					_stats.max_urgent_latency_us = latency;
+				}
+				_mutex.unlock();
+
+				resume = active;
+				completed = 1;
+			} else {
+				if(!active) {
+					_mutex.lock();
+					active = pop(_background, current);
+					_mutex.unlock();
+					if(!active) {
+						break;
+					}
+					next_row = current.rect.y0;
+					resume = true;
+				}
+
+				// Send as many whole rows as fit in a chunk (at least one)
+				const display_rect_t& r = current.rect;
+				uint32_t row_bytes = (r.x1 - r.x0 + 1) * current.bytes_per_pixel;
+				uint32_t rows = (row_bytes < _chunk_bytes) ? (_chunk_bytes / row_bytes) : 1;
+				if(rows > (r.y1 - next_row + 1)) {
+					rows = (r.y1 - next_row + 1);
+				}
+
+				if(resume) {
+					// Restart the memory write at the first row that hasn't been sent
+					set_window(r.x0, next_row, r.x1, r.y1);
+					_interface.write(MIPI_DCS_WRITE_MEMORY_START);
+					resume = false;
+				} else {
+					_interface.write(MIPI_DCS_WRITE_MEMORY_CONTINUE);
+				}
+				_interface.write(current.pixels + ((next_row - r.y0) * row_bytes), 0,
+						rows * row_bytes);
+				next_row += rows;
+
+				bool finished = (next_row > r.y1);
+				if(finished) {
+					active = false;
+					if(current.done) {
+						current.done();
+					}
+					completed = 1;
+				}
+
+				_mutex.lock();
+				_stats.chunks++;
+				if(finished) {
+					_stats.background_writes++;
+				}
+				_mutex.unlock();
+			}
+
+			if(completed) {
+				_mutex.lock();
+				_pending -= completed;
+				if(_pending == 0) {
+					_evt.set(SCHEDULER_IDLE_FLAG);
+				}
+				_mutex.unlock();
+			}
+		}
+
+		if(!_running) {
+			return;
+		}
+	}
+}
+
+bool WindowScheduler::pop(job_queue_t& queue, window_job_t& job) {
+	if(queue.count == 0) {
+		return false;
+	}
+	job = queue.jobs[queue.head];
+	queue.head = (queue.head + 1) % queue.capacity;
+	queue.count--;
+	return true;
+}
+
+void WindowScheduler::set_window(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1) {
+	uint8_t buf[5];
+
+	buf[0] = MIPI_DCS_SET_COLUMN_ADDRESS;
+	buf[1] = (x0 >> 8);
+	buf[2] = (x0 & 0xFF);
+	buf[3] = (x1 >> 8);
+	buf[4] = (x1 & 0xFF);
+	_interface.write(buf, 1, 5);
+
+	buf[0] = MIPI_DCS_SET_PAGE_ADDRESS;
+	buf[1] = (y0 >> 8);
+	buf[2] = (y0 & 0xFF);
+	buf[3] = (y1 >> 8);
+	buf[4] = (y1 & 0xFF);
+	_interface.write(buf, 1, 5);
+}
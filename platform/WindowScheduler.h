@@ -0,0 +1,187 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UDISPLAY_PLATFORM_WINDOWSCHEDULER_H_
+#define UDISPLAY_PLATFORM_WINDOWSCHEDULER_H_
+
+#include "DisplayInterface.h"
+#include "DisplayRect.h"
+
+#include "platform/Callback.h"
+#include "rtos/Thread.h"
+#include "rtos/Mutex.h"
+#include "rtos/EventFlags.h"
+
+/** Stack size of the scheduler thread */
+#ifndef WINDOW_SCHEDULER_STACK_SIZE
+#define WINDOW_SCHEDULER_STACK_SIZE 1024
+#endif
+
+/** Default maximum number of pixel bytes sent between two preemption points */
+#ifndef WINDOW_SCHEDULER_CHUNK_BYTES
+#define WINDOW_SCHEDULER_CHUNK_BYTES 4096
+#endif
+
+/** Number of urgent window writes that can be pending */
+#ifndef WINDOW_SCHEDULER_URGENT_SLOTS
+#define WINDOW_SCHEDULER_URGENT_SLOTS 4
+#endif
+
+/** Number of background window writes that can be pending */
+#ifndef WINDOW_SCHEDULER_BACKGROUND_SLOTS
+#define WINDOW_SCHEDULER_BACKGROUND_SLOTS 2
+#endif
+
+/**
+ * Window scheduler statistics
+ */
+typedef struct {
+	uint32_t background_writes;		/** Background windows completed */
+	uint32_t urgent_writes;			/** Urgent windows completed */
+	uint32_t chunks;				/** Background chunks sent */
+	uint32_t preemptions;			/** Times a background window was interrupted */
+	uint32_t max_urgent_latency_us;	/** Longest time between posting an urgent window and its first byte */
+} window_scheduler_stats_t;
+
+/**
+ * Preemptible window writer for MIPI DCS panels
+ *
+ * Large (background) window writes, such as full frames, are split into
+ * chunks of whole rows. Between two chunks, pending urgent window writes
+ * (cursor, alarm icon, touch feedback...) are sent in full, and the
+ * background window is then resumed by re-issuing its address window
+ * from the next row. The worst-case latency of an urgent write is
+ * therefore bounded by the time it takes to send one chunk.
+ *
+ * Chunks that follow each other without preemption continue the memory
+ * write with RAMWRC, so the panel's address window is only set again
+ * when it was actually changed.
+ *
+ * @note The interface must only be used by the scheduler while it is running
+ */
+class WindowScheduler
+{
+	public:
+
+		typedef enum {
+			PRIORITY_BACKGROUND,
+			PRIORITY_URGENT
+		} priority_t;
+
+		/** Executed by the scheduler thread once a window has been written */
+		typedef mbed::Callback<void()> done_t;
+
+		/**
+		 * Instantiate a window scheduler
+		 * @param[in] interface Interface to the panel
+		 * @param[in] chunk_bytes Maximum number of pixel bytes sent between two preemption points
+		 * @param[in] priority Priority of the scheduler thread
+		 */
+		WindowScheduler(DisplayInterface& interface,
+				uint32_t chunk_bytes = WINDOW_SCHEDULER_CHUNK_BYTES,
+				osPriority priority = osPriorityAboveNormal);
+
+		virtual ~WindowScheduler(void);
+
+		/**
+		 * Starts the scheduler thread
+		 * @note The scheduler can only be started once
+		 */
+		void start(void);
+
+		/**
+		 * Writes all pending windows and stops the scheduler thread
+		 */
+		void stop(void);
+
+		/**
+		 * Queues a window write
+		 * @param[in] rect Area of the display to write
+		 * @param[in] pixels Pixel data, must remain valid until done is called
+		 * @param[in] bytes_per_pixel Number of bytes per pixel on the wire
+		 * @param[in] priority Urgent writes preempt background writes between chunks
+		 * @param[in] done (optional) Executed once the window has been written
+		 * @retval true if queued, false if no slot is free for this priority or
+		 * the window is empty (x1 < x0, y1 < y0, no pixels or bytes_per_pixel of 0)
+		 */
+		bool write_window(const display_rect_t& rect, const uint8_t* pixels,
+				uint32_t bytes_per_pixel, priority_t priority = PRIORITY_BACKGROUND,
+				done_t done = NULL);
+
+		/**
+		 * Blocks until every queued window has been written
+		 */
+		void flush(void);
+
+		/**
+		 * Gets the scheduler statistics
+		 * @param[out] stats Snapshot to fill
+		 */
+		void get_stats(window_scheduler_stats_t& stats);
+
+	private:
+
+		typedef struct {
+			display_rect_t rect;
+			const uint8_t* pixels;
+			uint32_t bytes_per_pixel;
+			done_t done;
+			uint32_t posted_us;
+		} window_job_t;
+
+		typedef struct {
+			window_job_t jobs[WINDOW_SCHEDULER_URGENT_SLOTS > WINDOW_SCHEDULER_BACKGROUND_SLOTS ?
+					WINDOW_SCHEDULER_URGENT_SLOTS : WINDOW_SCHEDULER_BACKGROUND_SLOTS];
+			uint32_t capacity;
+			uint32_t head;
+			uint32_t count;
+		} job_queue_t;
+
+		/** Scheduler thread main loop */
+		void schedule_task(void);
+
+		/** Pops the oldest job of a queue, returns false if it is empty */
+		bool pop(job_queue_t& queue, window_job_t& job);
+
+		/** Sets the panel's address window */
+		void set_window(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1);
+
+		DisplayInterface& _interface;
+
+		uint32_t _chunk_bytes;
+
+		job_queue_t _urgent;
+
+		job_queue_t _background;
+
+		/** Protects the job queues and statistics */
+		rtos::Mutex _mutex;
+
+		rtos::EventFlags _evt;
+
+		/** Number of windows queued but not yet written */
+		volatile uint32_t _pending;
+
+		volatile bool _running;
+
+		rtos::Thread _thread;
+
+		window_scheduler_stats_t _stats;
+
+};
+
+#endif /* UDISPLAY_PLATFORM_WINDOWSCHEDULER_H_ */
@@ -8,6 +8,8 @@
 #ifndef MBED_LVGL_UDISPLAY_TARGETS_TARGET_NORDIC_TARGET_MCU_NRF52840_DISPLAYSPI_H_
 #define MBED_LVGL_UDISPLAY_TARGETS_TARGET_NORDIC_TARGET_MCU_NRF52840_DISPLAYSPI_H_
 
+#include <string.h>
+
 #include "PinNames.h"
 #include "platform/mbed_assert.h"
 #include "platform/Callback.h"
@@ -15,31 +17,150 @@
 #include "rtos/EventFlags.h"
 
 #include "nrfx_spim.h"
+#include "nrf_gpio.h"
 
 #include "DisplayInterface.h"
+#include "DisplayTrace.h"
+#include "SPIMChunker.h"
 
 #if defined(DEVICE_SPI)
 
-static const nrfx_spim_t m_spi_master_3 = NRFX_SPIM_INSTANCE(3);
+/**
+ * Transfer completion wait policies
+ * AUTO: Busy-poll transfers short enough to finish before an RTOS block/wake
+ *       cycle would, block on an event for longer ones
+ * SPIN: Always busy-poll
+ * BLOCK: Always block on an event
+ */
+#define DISPLAY_SPI_WAIT_AUTO	0
+#define DISPLAY_SPI_WAIT_SPIN	1
+#define DISPLAY_SPI_WAIT_BLOCK	2
+
+/** Default wait policy */
+#ifndef DISPLAY_SPI_WAIT_POLICY
+#define DISPLAY_SPI_WAIT_POLICY DISPLAY_SPI_WAIT_AUTO
+#endif
+
+/**
+ * Longest transfer time (in microseconds) busy-polled by the AUTO policy,
+ * roughly the cost of blocking on an event and being woken up again
+ */
+#ifndef DISPLAY_SPI_SPIN_THRESHOLD_US
+#define DISPLAY_SPI_SPIN_THRESHOLD_US 20
+#endif
+
+/**
+ * Size of each of the two RAM bounce buffers used to send data stored
+ * in flash (EasyDMA can only read from RAM). Set to 0 to disable.
+ */
+#ifndef DISPLAY_SPI_BOUNCE_BUFFER_SIZE
+#define DISPLAY_SPI_BOUNCE_BUFFER_SIZE 512
+#endif
 
 extern "C" {
+	void nrfx_spim_0_irq_handler(void);
+	void nrfx_spim_1_irq_handler(void);
+	void nrfx_spim_2_irq_handler(void);
 	void nrfx_spim_3_irq_handler(void);
 }
 
-static void spim3_event_handler(nrfx_spim_evt_t const * p_event, void * p_context);
+/** nrfx SPIM IRQ handler installed in the vector table */
+typedef void (*display_spim_irq_handler_t)(void);
+
+/**
+ * Compile-time description of an SPIM peripheral instance
+ *
+ * SPIM0-2 share their IRQ (and registers) with the TWI/SPIS/SPI peripherals
+ * of the same index, which must not be used by anything else.
+ */
+template<uint8_t N>
+struct DisplaySPIMInstance;
+
+#if NRFX_SPIM0_ENABLED
+template<>
+struct DisplaySPIMInstance<0> {
+	static const nrfx_spim_t* spim(void) {
+		static const nrfx_spim_t instance = NRFX_SPIM_INSTANCE(0);
+		return &instance;
+	}
+	static IRQn_Type irqn(void) { return SPIM0_SPIS0_TWIM0_TWIS0_SPI0_TWI0_IRQn; }
+	static display_spim_irq_handler_t irq_handler(void) { return nrfx_spim_0_irq_handler; }
+	static const bool has_dcx = false;
+	static const uint32_t max_hz = 8000000;
+};
+#endif
+
+#if NRFX_SPIM1_ENABLED
+template<>
+struct DisplaySPIMInstance<1> {
+	static const nrfx_spim_t* spim(void) {
+		static const nrfx_spim_t instance = NRFX_SPIM_INSTANCE(1);
+		return &instance;
+	}
+	static IRQn_Type irqn(void) { return SPIM1_SPIS1_TWIM1_TWIS1_SPI1_TWI1_IRQn; }
+	static display_spim_irq_handler_t irq_handler(void) { return nrfx_spim_1_irq_handler; }
+	static const bool has_dcx = false;
+	static const uint32_t max_hz = 8000000;
+};
+#endif
+
+#if NRFX_SPIM2_ENABLED
+template<>
+struct DisplaySPIMInstance<2> {
+	static const nrfx_spim_t* spim(void) {
+		static const nrfx_spim_t instance = NRFX_SPIM_INSTANCE(2);
+		return &instance;
+	}
+	static IRQn_Type irqn(void) { return SPIM2_SPIS2_SPI2_IRQn; }
+	static display_spim_irq_handler_t irq_handler(void) { return nrfx_spim_2_irq_handler; }
+	static const bool has_dcx = false;
+	static const uint32_t max_hz = 8000000;
+};
+#endif
+
+#if NRFX_SPIM3_ENABLED
+template<>
+struct DisplaySPIMInstance<3> {
+	static const nrfx_spim_t* spim(void) {
+		static const nrfx_spim_t instance = NRFX_SPIM_INSTANCE(3);
+		return &instance;
+	}
+	static IRQn_Type irqn(void) { return SPIM3_IRQn; }
+	static display_spim_irq_handler_t irq_handler(void) { return nrfx_spim_3_irq_handler; }
+	static const bool has_dcx = true;
+	static const uint32_t max_hz = 32000000;
+};
+#endif
 
 /**
  * Hardware-accelerated SPI4Wire interface
- * On the nRF52840, the SPIM3 interface features
- * a hardware-controlled Data/Command pin
- * commonly used with displays over SPI
+ * Uses the nRF52840's SPIM peripheral N (0 to 3) with EasyDMA.
+ *
+ * SPIM3 features a hardware-controlled Data/Command pin
+ * commonly used with displays over SPI, so a transaction mixing
+ * command and data bytes is a single transfer. SPIM0-2 drive the
+ * Data/Command pin as a GPIO between a command and a data transfer.
+ *
+ * Each instance has its own peripheral and event handler, so several
+ * displays can be driven in parallel on separate buses.
+ *
+ * Transactions longer than EasyDMA can handle in one transfer are split
+ * into chunks, chained back-to-back from the SPIM event handler.
+ *
+ * Buffers outside of RAM (eg: images stored in flash) are streamed through
+ * two small bounce buffers: while one is on the wire, the event handler
+ * copies the next chunk into the other.
  *
  * @note Not synchronized. Should be synchronized externally by
  * user application code using the event callback.
  */
-class DisplaySPI : public DisplayInterface
+template<uint8_t N>
+class DisplaySPIM : public DisplayInterface
 {
 	public:
+
+		typedef DisplaySPIMInstance<N> instance_t;
+
 		/**
 		 * Instantiate a 4-wire SPI display interface
 		 * @note This constructor does not allow a shared SPI bus
@@ -48,15 +169,29 @@ class DisplaySPI : public DisplayInterface
 		 * @param[in] sclk SCLK pin for interface
 		 * @param[in] cs Chip select pin for interface
 		 * @param[in] dcx Data/Command pin for interface
+		 * @param[in] hz (optional) SPI clock frequency, rounded down to a supported frequency
 		 */
-		DisplaySPI(PinName mosi, PinName sclk, PinName cs, PinName dcx) :
-			user_callback(NULL), spim_done_evt() {
+		DisplaySPIM(PinName mosi, PinName sclk, PinName cs, PinName dcx, uint32_t hz = 8000000) :
+			user_callback(NULL), spim_done_evt(), _dcx(dcx), _xfer_done(false),
+			_wait_policy(DISPLAY_SPI_WAIT_POLICY) {
+
+			nrf_spim_frequency_t frequency = supported_frequency(hz);
+
+			// Number of bytes that go out on the wire within the spin threshold
+			_spin_threshold = (uint32_t) (((uint64_t) _frequency_hz * DISPLAY_SPI_SPIN_THRESHOLD_US)
+					/ (8 * 1000000));
 
 			// Install the nrfx driver IRQ
-			NVIC_SetVector(SPIM3_IRQn, (uint32_t)(nrfx_spim_3_irq_handler));
+			NVIC_SetVector(instance_t::irqn(), (uint32_t)(instance_t::irq_handler()));
+
+			if(!instance_t::has_dcx) {
+				// Data/Command is driven as a GPIO
+				nrf_gpio_cfg_output(dcx);
+				nrf_gpio_pin_set(dcx);
+			}
 
 			/**
-			 * Initialize the SPIM3 peripheral
+			 * Initialize the SPIM peripheral
 			 */
 		    nrfx_spim_config_t spi_config;
 		    spi_config.irq_priority = 7;
@@ -65,28 +200,28 @@ class DisplaySPI : public DisplayInterface
 		    spi_config.bit_order = NRF_SPIM_BIT_ORDER_MSB_FIRST;
 		    spi_config.rx_delay = 0x00;
 		    spi_config.ss_duration = 0x00;
-		    spi_config.frequency      = NRF_SPIM_FREQ_8M;
+		    spi_config.frequency      = frequency;
 		    spi_config.ss_pin         = cs;
 		    spi_config.miso_pin       = NRFX_SPIM_PIN_NOT_USED;
 		    spi_config.mosi_pin       = mosi;
 		    spi_config.sck_pin        = sclk;
-		    spi_config.dcx_pin        = dcx;
+		    spi_config.dcx_pin        = (instance_t::has_dcx ? dcx : NRFX_SPIM_PIN_NOT_USED);
 		    spi_config.use_hw_ss      = true;
 		    spi_config.ss_active_high = false;
-		    nrfx_err_t err = nrfx_spim_init(&m_spi_master_3, &spi_config,
-		    		spim3_event_handler,
+		    nrfx_err_t err = nrfx_spim_init(instance_t::spim(), &spi_config,
+		    		&DisplaySPIM::spim_event_handler,
 				this);	// Pass a handle to this instance for event processing
 
 		    MBED_ASSERT(err == NRF_SUCCESS);
 
 		}
 
-		virtual ~DisplaySPI(void) {
+		virtual ~DisplaySPIM(void) {
 
 			/**
-			 * Deinitialize the SPIM3 peripheral
+			 * Deinitialize the SPIM peripheral
 			 */
-			nrfx_spim_uninit(&m_spi_master_3);
+			nrfx_spim_uninit(instance_t::spim());
 
 		}
 
@@ -97,13 +232,28 @@ class DisplaySPI : public DisplayInterface
 			user_callback = cb;
 		}
 
+		/**
+		 * Sets the default transfer completion wait policy
+		 * @param[in] policy DISPLAY_SPI_WAIT_AUTO, DISPLAY_SPI_WAIT_SPIN or DISPLAY_SPI_WAIT_BLOCK
+		 */
+		void set_wait_policy(int policy) {
+			_wait_policy = policy;
+		}
+
+		/**
+		 * Gets the SPI clock frequency actually used
+		 */
+		uint32_t frequency(void) const {
+			return _frequency_hz;
+		}
+
 		/**
 		 * Writes a single-byte to the display interface
 		 * @param[in] data Single byte to send to the display interface
 		 * @param[in] is_cmd Is the byte a command (true) or data (false)?
 		 */
 		virtual void write(uint8_t data, bool is_cmd = true) {
-			this->write(&data, 1, 1);
+			this->write(&data, (is_cmd ? 1 : 0), 1);
 		}
 
 		/**
@@ -113,15 +263,55 @@ class DisplaySPI : public DisplayInterface
 		 * @param[in] buf_len Total number of bytes in payload buffer
 		 */
 		virtual void write(const uint8_t* buffer, uint32_t num_cmd_bytes, uint32_t buf_len) {
+			write(buffer, num_cmd_bytes, buf_len, _wait_policy);
+		}
 
-			nrfx_spim_xfer_desc_t xfer_desc;
-			xfer_desc.p_rx_buffer = NULL;
-			xfer_desc.p_tx_buffer = buffer;
-			xfer_desc.rx_length = 0;
-			xfer_desc.tx_length = buf_len;
-			spim_done_evt.clear();
-			nrfx_spim_xfer_dcx(&m_spi_master_3, &xfer_desc, 0, num_cmd_bytes);
-			wait_for_xfer_done();
+		/**
+		 * Writes a buffer to the display interface with a given wait policy
+		 * @param[in] buffer pointer to buffer of bytes to transmit
+		 * @param[in] num_cmd_bytes Number of command bytes at beginning of buffer
+		 * @param[in] buf_len Total number of bytes in payload buffer
+		 * @param[in] policy Wait policy for this transfer
+		 */
+		void write(const uint8_t* buffer, uint32_t num_cmd_bytes, uint32_t buf_len, int policy) {
+			if(instance_t::has_dcx || num_cmd_bytes == 0) {
+				transfer(buffer, num_cmd_bytes, buf_len, policy);
+			} else {
+				// No hardware D/C, send the command and data phases separately
+				nrf_gpio_pin_clear(_dcx);
+				transfer(buffer, num_cmd_bytes, num_cmd_bytes, policy);
+				nrf_gpio_pin_set(_dcx);
+				if(buf_len > num_cmd_bytes) {
+					transfer(buffer + num_cmd_bytes, 0, (buf_len - num_cmd_bytes), policy);
+				}
+			}
+			_stats.record_transaction(num_cmd_bytes, buf_len);
+		}
+
+		/**
+		 * Writes rows of data spaced by a stride
+		 * Each row is a separate EasyDMA transfer, chained from the SPIM event handler
+		 * @param[in] base pointer to the first byte of the first row
+		 * @param[in] stride Distance in bytes between the start of two rows
+		 * @param[in] row_bytes Number of bytes to write from each row
+		 * @param[in] rows Number of rows
+		 */
+		virtual void write_strided(const uint8_t* base, uint32_t stride, uint32_t row_bytes, uint32_t rows) {
+			uint32_t length = row_bytes * rows;
+			if(length == 0) {
+				return;
+			}
+#if UDISPLAY_TRACE_ENABLED
+			_trace_start = DisplayTrace::now();
+			_trace_command = 0;
+			_trace_num_cmd_bytes = 0;
+			_trace_length = length;
+#endif
+			bool bounce = needs_bounce(base);
+			_chunker.start_strided(base, stride, row_bytes, rows,
+					(bounce ? DISPLAY_SPI_BOUNCE_BUFFER_SIZE : 0));
+			run_chunks(bounce, length, _wait_policy);
+			_stats.record_transaction(0, length);
 		}
 
 		/**
@@ -140,7 +330,20 @@ class DisplaySPI : public DisplayInterface
 		 */
 		void _spim_event(nrfx_spim_evt_t const* evt) {
 
+			// Chain the next chunk of a long transaction straight away
+			if(start_next_chunk()) {
+				return;
+			}
+
+#if UDISPLAY_TRACE_ENABLED
+			DisplayTrace::log(this, _trace_start, _trace_command,
+					_trace_num_cmd_bytes, _trace_length);
+#endif
+
+			_stats.record_queue_depth(0);
+
 			// Signal the SPIM transfer is done
+			_xfer_done = true;
 			spim_done_evt.set(0x1);
 
 			if(this->user_callback) {
@@ -150,29 +353,248 @@ class DisplaySPI : public DisplayInterface
 
 	private:
 
+		/**
+		 * nrfx event handler, forwards events to the instance they belong to
+		 */
+		static void spim_event_handler(nrfx_spim_evt_t const * p_event, void * p_context) {
+			// Cast the context into a DisplaySPIM pointer
+			DisplaySPIM* interface = (DisplaySPIM*) p_context;
+			if(interface != NULL) {
+				interface->_spim_event(p_event);
+			}
+		}
+
+		/**
+		 * Starts a transfer and waits for it to complete
+		 */
+		void transfer(const uint8_t* buffer, uint32_t num_cmd_bytes, uint32_t length, int policy) {
+			if(length == 0) {
+				return;
+			}
+#if UDISPLAY_TRACE_ENABLED
+			// The transaction is logged from the SPIM event handler
+			_trace_start = DisplayTrace::now();
+			_trace_command = (num_cmd_bytes ? buffer[0] : 0);
+			_trace_num_cmd_bytes = num_cmd_bytes;
+			_trace_length = length;
+#endif
+			bool bounce = needs_bounce(buffer);
+			_chunker.start(buffer, num_cmd_bytes, length,
+					(bounce ? DISPLAY_SPI_BOUNCE_BUFFER_SIZE : 0));
+			run_chunks(bounce, length, policy);
+		}
+
+		/**
+		 * Sends the transaction set up in the chunker and waits for it to complete
+		 * @param[in] bounce Send the chunks through the bounce buffers
+		 * @param[in] length Total number of bytes in the transaction
+		 * @param[in] policy Wait policy
+		 */
+		void run_chunks(bool bounce, uint32_t length, int policy) {
+			spim_done_evt.clear();
+			_xfer_done = false;
+			_stats.record_queue_depth(1);
+
+#if DISPLAY_SPI_BOUNCE_BUFFER_SIZE > 0
+			_bouncing = bounce;
+			if(_bouncing) {
+				// Fill both bounce buffers, the event handler takes it from there
+				fill_bounce_buffer(0);
+				fill_bounce_buffer(1);
+				_bounce_next = 1;
+				start_xfer(_bounce[0], _bounce_len[0], _bounce_cmd_bytes[0]);
+			} else
+#endif
+			{
+				start_next_chunk();
+			}
+
+			if(policy == DISPLAY_SPI_WAIT_SPIN ||
+					(policy == DISPLAY_SPI_WAIT_AUTO && length <= _spin_threshold)) {
+				spin_for_xfer_done();
+			} else {
+				wait_for_xfer_done();
+			}
+		}
+
+		/**
+		 * Starts the transfer of the next chunk of the current transaction
+		 * @retval true if a chunk was started, false if the transaction is complete
+		 */
+		bool start_next_chunk(void) {
+#if DISPLAY_SPI_BOUNCE_BUFFER_SIZE > 0
+			if(_bouncing) {
+				uint8_t current = _bounce_next;
+				if(_bounce_len[current] == 0) {
+					return false;
+				}
+				start_xfer(_bounce[current], _bounce_len[current], _bounce_cmd_bytes[current]);
+
+				// Refill the buffer that just went out while this one is on the wire
+				_bounce_next = current ^ 1;
+				fill_bounce_buffer(_bounce_next);
+				return true;
+			}
+#endif
+
+			const uint8_t* chunk;
+			uint32_t chunk_len, chunk_cmd_bytes;
+			if(!_chunker.next(chunk, chunk_len, chunk_cmd_bytes)) {
+				return false;
+			}
+			start_xfer(chunk, chunk_len, chunk_cmd_bytes);
+			return true;
+		}
+
+		/**
+		 * Checks if a buffer must go through the bounce buffers (EasyDMA can only read RAM)
+		 */
+		bool needs_bounce(const uint8_t* buffer) {
+#if DISPLAY_SPI_BOUNCE_BUFFER_SIZE > 0
+			return !nrfx_is_in_ram(buffer);
+#else
+			return false;
+#endif
+		}
+
+		/**
+		 * Starts an EasyDMA transfer
+		 */
+		void start_xfer(const uint8_t* buffer, uint32_t length, uint32_t num_cmd_bytes) {
+			nrfx_spim_xfer_desc_t xfer_desc;
+			xfer_desc.p_rx_buffer = NULL;
+			xfer_desc.p_tx_buffer = buffer;
+			xfer_desc.rx_length = 0;
+			xfer_desc.tx_length = length;
+			if(instance_t::has_dcx) {
+				nrfx_spim_xfer_dcx(instance_t::spim(), &xfer_desc, 0, num_cmd_bytes);
+			} else {
+				nrfx_spim_xfer(instance_t::spim(), &xfer_desc, 0);
+			}
+		}
+
+#if DISPLAY_SPI_BOUNCE_BUFFER_SIZE > 0
+		/**
+		 * Copies the next chunk of the current transaction into a bounce buffer
+		 * (left empty if the whole transaction has been copied)
+		 */
+		void fill_bounce_buffer(uint8_t index) {
+			const uint8_t* chunk;
+			uint32_t chunk_len, chunk_cmd_bytes;
+			if(_chunker.next(chunk, chunk_len, chunk_cmd_bytes)) {
+				memcpy(_bounce[index], chunk, chunk_len);
+				_bounce_len[index] = chunk_len;
+				_bounce_cmd_bytes[index] = chunk_cmd_bytes;
+			} else {
+				_bounce_len[index] = 0;
+			}
+		}
+#endif
+
 		/**
 		 * Blocks the calling thread until a transfer is done
 		 */
 		void wait_for_xfer_done(void) {
 			/** If it hasn't happened yet, wait for it */
 			if(!spim_done_evt.clear()) {
+				uint32_t blocked_start = DisplayStats::now();
 				spim_done_evt.wait_any(0xff);
+				_stats.record_blocked(blocked_start);
+			}
+		}
+
+		/**
+		 * Busy-polls until a transfer is done
+		 */
+		void spin_for_xfer_done(void) {
+			uint32_t blocked_start = DisplayStats::now();
+			while(!_xfer_done) { }
+			_stats.record_blocked(blocked_start);
+
+			// The event was set too, don't let it satisfy the next wait
+			spim_done_evt.clear();
+		}
+
+		/**
+		 * Gets the fastest supported frequency that does not exceed hz
+		 */
+		nrf_spim_frequency_t supported_frequency(uint32_t hz) {
+			static const struct {
+				uint32_t hz;
+				nrf_spim_frequency_t frequency;
+			} frequencies[] = {
+				{ 32000000, NRF_SPIM_FREQ_32M },
+				{ 16000000, NRF_SPIM_FREQ_16M },
+				{ 8000000, NRF_SPIM_FREQ_8M },
+				{ 4000000, NRF_SPIM_FREQ_4M },
+				{ 2000000, NRF_SPIM_FREQ_2M },
+				{ 1000000, NRF_SPIM_FREQ_1M },
+				{ 500000, NRF_SPIM_FREQ_500K },
+				{ 250000, NRF_SPIM_FREQ_250K },
+			};
+
+			// Only SPIM3 runs faster than 8MHz
+			if(hz > instance_t::max_hz) {
+				hz = instance_t::max_hz;
+			}
+
+			for(uint32_t i = 0; i < (sizeof(frequencies) / sizeof(frequencies[0])); i++) {
+				if(hz >= frequencies[i].hz) {
+					_frequency_hz = frequencies[i].hz;
+					return frequencies[i].frequency;
+				}
 			}
+			_frequency_hz = 125000;
+			return NRF_SPIM_FREQ_125K;
 		}
 
 		mbed::Callback<void(nrfx_spim_evt_t const *)> user_callback;
 
 		rtos::EventFlags spim_done_evt;
 
+		/** Data/Command pin, driven as a GPIO by instances without hardware D/C */
+		PinName _dcx;
+
+		/** Splits the current transaction into EasyDMA transfers */
+		SPIMChunker _chunker;
+
+#if DISPLAY_SPI_BOUNCE_BUFFER_SIZE > 0
+		/** Indicates if the current transaction goes through the bounce buffers */
+		bool _bouncing;
+
+		/** Bounce buffers and the chunks they hold */
+		uint8_t _bounce[2][DISPLAY_SPI_BOUNCE_BUFFER_SIZE];
+		uint32_t _bounce_len[2];
+		uint32_t _bounce_cmd_bytes[2];
+
+		/** Bounce buffer to send next */
+		uint8_t _bounce_next;
+#endif
+
+		/** Set from the SPIM event handler when a transfer is done */
+		volatile bool _xfer_done;
+
+		/** Default wait policy */
+		int _wait_policy;
+
+		/** SPI clock frequency */
+		uint32_t _frequency_hz;
+
+		/** Longest transfer (in bytes) busy-polled by the AUTO policy */
+		uint32_t _spin_threshold;
+
+#if UDISPLAY_TRACE_ENABLED
+		/** Details of the transfer in progress, logged on completion */
+		uint32_t _trace_start;
+		uint8_t _trace_command;
+		uint32_t _trace_num_cmd_bytes;
+		uint32_t _trace_length;
+#endif
+
 };
 
-void spim3_event_handler(nrfx_spim_evt_t const * p_event, void * p_context) {
-	// Cast the context into a DisplaySPI pointer
-	DisplaySPI* interface = (DisplaySPI*) p_context;
-	if(interface != NULL) {
-		interface->_spim_event(p_event);
-	}
-}
+/** The original DisplaySPI uses SPIM3, the only instance with hardware D/C */
+typedef DisplaySPIM<3> DisplaySPI;
 
 #endif /** defined(DEVICE_SPI) */
 
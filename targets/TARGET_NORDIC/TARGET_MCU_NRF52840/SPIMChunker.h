@@ -0,0 +1,167 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UDISPLAY_TARGETS_NRF52840_SPIMCHUNKER_H_
+#define UDISPLAY_TARGETS_NRF52840_SPIMCHUNKER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Largest EasyDMA transfer length
+ * TXD.MAXCNT is 16 bits on the nRF52840. The default is the largest
+ * multiple of 2, 3 and 4 below 65536, so pixels never straddle two chunks.
+ */
+#ifndef DISPLAY_SPI_MAX_XFER_LEN
+#define DISPLAY_SPI_MAX_XFER_LEN 65532
+#endif
+
+/**
+ * Largest number of command bytes in a single transfer
+ * DCXCNT is 4 bits and 0xF means every byte is a command, so 14 is the
+ * largest count that is followed by data.
+ */
+#ifndef DISPLAY_SPI_MAX_CMD_BYTES
+#define DISPLAY_SPI_MAX_CMD_BYTES 14
+#endif
+
+/**
+ * Splits a transaction into transfers EasyDMA can handle
+ *
+ * A transaction is either a contiguous buffer, or rows of equal length
+ * spaced by a stride (eg: a sub-rectangle of a framebuffer). Rows are
+ * never merged, and rows longer than the chunk length are split.
+ *
+ * Command bytes (counted by the hardware D/C logic) only ever appear at
+ * the beginning of a chunk. A chunk never holds more than
+ * DISPLAY_SPI_MAX_CMD_BYTES of them: longer command phases are sent as
+ * command-only chunks first. This class has no hardware dependencies so
+ * it can be tested on a host.
+ */
+class SPIMChunker
+{
+	public:
+
+		/**
+		 * @param[in] max_len Largest chunk length
+		 */
+		SPIMChunker(uint32_t max_len = DISPLAY_SPI_MAX_XFER_LEN) : _max_len(max_len),
+			_chunk_len(max_len), _row(NULL), _stride(0), _row_bytes(0), _rows(0),
+			_offset(0), _num_cmd_bytes(0) {
+		}
+
+		/**
+		 * Starts splitting a new transaction
+		 * @param[in] buffer Transaction bytes
+		 * @param[in] num_cmd_bytes Number of command bytes at beginning of buffer
+		 * @param[in] length Total number of bytes
+		 * @param[in] chunk_len (optional) Use smaller chunks for this transaction (eg: bounce buffer size)
+		 */
+		void start(const uint8_t* buffer, uint32_t num_cmd_bytes, uint32_t length,
+				uint32_t chunk_len = 0) {
+			start_strided(buffer, length, length, 1, chunk_len);
+			_num_cmd_bytes = num_cmd_bytes;
+		}
+
+		/**
+		 * Starts splitting a new strided (data only) transaction
+		 * @param[in] base First byte of the first row
+		 * @param[in] stride Distance in bytes between the start of two rows
+		 * @param[in] row_bytes Number of bytes to send from each row
+		 * @param[in] rows Number of rows
+		 * @param[in] chunk_len (optional) Use smaller chunks for this transaction (eg: bounce buffer size)
+		 */
+		void start_strided(const uint8_t* base, uint32_t stride, uint32_t row_bytes,
+				uint32_t rows, uint32_t chunk_len = 0) {
+			_chunk_len = (chunk_len && chunk_len < _max_len) ? chunk_len : _max_len;
+			_row = base;
+			_stride = stride;
+			_row_bytes = row_bytes;
+			_rows = (row_bytes ? rows : 0);
+			_offset = 0;
+			_num_cmd_bytes = 0;
+		}
+
+		/**
+		 * Gets the next chunk of the transaction
+		 * @param[out] chunk Start of the chunk
+		 * @param[out] chunk_len Length of the chunk
+		 * @param[out] chunk_cmd_bytes Number of command bytes at beginning of the chunk
+		 * @retval true if a chunk was returned, false if the transaction is complete
+		 */
+		bool next(const uint8_t*& chunk, uint32_t& chunk_len, uint32_t& chunk_cmd_bytes) {
+			if(_rows == 0) {
+				return false;
+			}
+
+			uint32_t left = _row_bytes - _offset;
+			chunk = _row + _offset;
+			chunk_len = (left > _chunk_len) ? _chunk_len : left;
+			chunk_cmd_bytes = _num_cmd_bytes;
+			if(chunk_cmd_bytes > DISPLAY_SPI_MAX_CMD_BYTES) {
+				chunk_cmd_bytes = DISPLAY_SPI_MAX_CMD_BYTES;
+			}
+			if(chunk_cmd_bytes > chunk_len) {
+				chunk_cmd_bytes = chunk_len;
+			}
+			if(chunk_cmd_bytes < _num_cmd_bytes) {
+				// More command bytes follow, end the chunk with the command phase
+				chunk_len = chunk_cmd_bytes;
+			}
+
+			_num_cmd_bytes -= chunk_cmd_bytes;
+			_offset += chunk_len;
+			if(_offset == _row_bytes) {
+				_row += _stride;
+				_rows--;
+				_offset = 0;
+			}
+			return true;
+		}
+
+		/**
+		 * Checks if every chunk of the transaction has been returned
+		 */
+		bool done(void) const {
+			return (_rows == 0);
+		}
+
+	private:
+
+		uint32_t _max_len;
+
+		/** Chunk length of the current transaction */
+		uint32_t _chunk_len;
+
+		/** Current row */
+		const uint8_t* _row;
+
+		uint32_t _stride;
+
+		uint32_t _row_bytes;
+
+		/** Rows left, including the current one */
+		uint32_t _rows;
+
+		/** Offset of the next chunk in the current row */
+		uint32_t _offset;
+
+		uint32_t _num_cmd_bytes;
+
+};
+
+#endif /* UDISPLAY_TARGETS_NRF52840_SPIMCHUNKER_H_ */
@@ -0,0 +1,75 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UDISPLAY_TARGETS_NRF52840_FAST_GPIO_DEVICE_H_
+#define UDISPLAY_TARGETS_NRF52840_FAST_GPIO_DEVICE_H_
+
+#include <stdint.h>
+
+#include "PinNames.h"
+#include "nrf_gpio.h"
+
+/**
+ * nRF52840 fast GPIO: stores to the port's OUTSET/OUTCLR registers
+ */
+typedef struct {
+	volatile uint32_t* outset;
+	volatile uint32_t* outclr;
+	uint32_t mask;
+} fast_gpio_t;
+
+static inline void fast_gpio_init(fast_gpio_t* obj, PinName pin, int value) {
+	if(pin == NC) {
+		// Writing a zero mask to OUTSET/OUTCLR does nothing
+		obj->outset = &NRF_P0->OUTSET;
+		obj->outclr = &NRF_P0->OUTCLR;
+		obj->mask = 0;
+		return;
+	}
+
+	uint32_t pin_number = (uint32_t) pin;
+	NRF_GPIO_Type* port = nrf_gpio_pin_port_decode(&pin_number);
+	obj->outset = &port->OUTSET;
+	obj->outclr = &port->OUTCLR;
+	obj->mask = (1UL << pin_number);
+
+	// Set the initial level before enabling the output to avoid a glitch
+	if(value) {
+		*obj->outset = obj->mask;
+	} else {
+		*obj->outclr = obj->mask;
+	}
+	nrf_gpio_cfg_output((uint32_t) pin);
+}
+
+static inline void fast_gpio_set(fast_gpio_t* obj) {
+	*obj->outset = obj->mask;
+}
+
+static inline void fast_gpio_clear(fast_gpio_t* obj) {
+	*obj->outclr = obj->mask;
+}
+
+static inline void fast_gpio_write(fast_gpio_t* obj, int value) {
+	if(value) {
+		*obj->outset = obj->mask;
+	} else {
+		*obj->outclr = obj->mask;
+	}
+}
+
+#endif /* UDISPLAY_TARGETS_NRF52840_FAST_GPIO_DEVICE_H_ */
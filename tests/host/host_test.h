@@ -0,0 +1,56 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Minimal check macros for host tests
+ *
+ * Each test program returns the number of failed checks from main().
+ */
+
+#ifndef UDISPLAY_TESTS_HOST_HOST_TEST_H_
+#define UDISPLAY_TESTS_HOST_HOST_TEST_H_
+
+#include <stdio.h>
+
+static int host_test_failures = 0;
+
+/** Records a failure (and carries on) if cond is false */
+#define HOST_CHECK(cond) do { \
+		if(!(cond)) { \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			host_test_failures++; \
+		} \
+	} while(0)
+
+/** Records a failure if two integers differ */
+#define HOST_CHECK_EQUAL(expected, actual) do { \
+		long long _e = (long long) (expected), _a = (long long) (actual); \
+		if(_e != _a) { \
+			fprintf(stderr, "%s:%d: %s: expected %lld, got %lld\n", __FILE__, __LINE__, \
+					#actual, _e, _a); \
+			host_test_failures++; \
+		} \
+	} while(0)
+
+/** Runs a test function */
+#define HOST_RUN(test) do { \
+		int _before = host_test_failures; \
+		test(); \
+		printf("%s %s\n", (host_test_failures == _before) ? "PASS" : "FAIL", #test); \
+	} while(0)
+
+#endif /* UDISPLAY_TESTS_HOST_HOST_TEST_H_ */
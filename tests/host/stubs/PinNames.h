@@ -0,0 +1,31 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Host test stand-in for the target's PinNames.h
+ */
+
+#ifndef UDISPLAY_TESTS_HOST_STUBS_PINNAMES_H_
+#define UDISPLAY_TESTS_HOST_STUBS_PINNAMES_H_
+
+typedef enum {
+	P0_0 = 0, P0_1, P0_2, P0_3, P0_4, P0_5, P0_6, P0_7,
+	P0_8, P0_9, P0_10, P0_11, P0_12, P0_13, P0_14, P0_15,
+	NC = (int) 0xFFFFFFFF
+} PinName;
+
+#endif /* UDISPLAY_TESTS_HOST_STUBS_PINNAMES_H_ */
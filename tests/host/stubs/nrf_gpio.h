@@ -0,0 +1,35 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Host test stand-in for the nRF GPIO HAL, implemented by nrfx_fake.cpp
+ */
+
+#ifndef UDISPLAY_TESTS_HOST_STUBS_NRF_GPIO_H_
+#define UDISPLAY_TESTS_HOST_STUBS_NRF_GPIO_H_
+
+#include <stdint.h>
+
+void nrf_gpio_cfg_output(uint32_t pin_number);
+
+void nrf_gpio_pin_set(uint32_t pin_number);
+
+void nrf_gpio_pin_clear(uint32_t pin_number);
+
+void nrf_gpio_pin_write(uint32_t pin_number, uint32_t value);
+
+#endif /* UDISPLAY_TESTS_HOST_STUBS_NRF_GPIO_H_ */
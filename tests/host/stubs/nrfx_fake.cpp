@@ -0,0 +1,194 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "nrfx_fake.h"
+#include "nrf_gpio.h"
+
+#include <string.h>
+
+#include <deque>
+
+namespace {
+
+struct spim_state_t {
+	bool initialized;
+	nrfx_spim_config_t config;
+	nrfx_spim_evt_handler_t handler;
+	void* context;
+	bool in_handler;
+	std::deque<nrfx_spim_xfer_desc_t> pending;
+};
+
+spim_state_t spims[NRFX_FAKE_SPIM_COUNT];
+
+std::vector<nrfx_fake_xfer_t> recorded;
+
+int levels[NRFX_FAKE_PIN_COUNT];
+
+bool outputs[NRFX_FAKE_PIN_COUNT];
+
+uint32_t watched_pin = NRFX_FAKE_PIN_COUNT;
+
+const uint8_t* flash_start = NULL;
+
+size_t flash_size = 0;
+
+void record(nrfx_spim_t const* p_instance, nrfx_spim_xfer_desc_t const* p_xfer_desc,
+		bool hw_dcx, uint32_t cmd_bytes) {
+	nrfx_fake_xfer_t xfer;
+	xfer.instance = p_instance->drv_inst_idx;
+	xfer.hw_dcx = hw_dcx;
+	xfer.cmd_bytes = cmd_bytes;
+	xfer.dc_level = nrfx_fake::pin_level(watched_pin);
+	xfer.tx = p_xfer_desc->p_tx_buffer;
+	xfer.bytes.assign(p_xfer_desc->p_tx_buffer, p_xfer_desc->p_tx_buffer + p_xfer_desc->tx_length);
+	recorded.push_back(xfer);
+
+	// The transfer is over as soon as it started. Like the SPIM IRQ, the
+	// handler is not re-entered: a transfer started from the handler
+	// completes once the handler returns.
+	spim_state_t& spim = spims[p_instance->drv_inst_idx];
+	spim.pending.push_back(*p_xfer_desc);
+	if(spim.in_handler) {
+		return;
+	}
+	spim.in_handler = true;
+	while(!spim.pending.empty()) {
+		nrfx_spim_evt_t evt;
+		evt.type = NRFX_SPIM_EVENT_DONE;
+		evt.xfer_desc = spim.pending.front();
+		spim.pending.pop_front();
+		spim.handler(&evt, spim.context);
+	}
+	spim.in_handler = false;
+}
+
+}
+
+namespace nrfx_fake {
+
+void reset(void) {
+	for(uint32_t i = 0; i < NRFX_FAKE_SPIM_COUNT; i++) {
+		spims[i].initialized = false;
+		memset(&spims[i].config, 0, sizeof(spims[i].config));
+		spims[i].handler = NULL;
+		spims[i].context = NULL;
+		spims[i].in_handler = false;
+		spims[i].pending.clear();
+	}
+	recorded.clear();
+	for(uint32_t i = 0; i < NRFX_FAKE_PIN_COUNT; i++) {
+		levels[i] = -1;
+		outputs[i] = false;
+	}
+	watched_pin = NRFX_FAKE_PIN_COUNT;
+	flash_start = NULL;
+	flash_size = 0;
+}
+
+const std::vector<nrfx_fake_xfer_t>& xfers(void) {
+	return recorded;
+}
+
+void clear_xfers(void) {
+	recorded.clear();
+}
+
+bool initialized(uint8_t instance) {
+	return spims[instance].initialized;
+}
+
+const nrfx_spim_config_t& config(uint8_t instance) {
+	return spims[instance].config;
+}
+
+void watch_pin(uint32_t pin) {
+	watched_pin = pin;
+}
+
+int pin_level(uint32_t pin) {
+	return (pin < NRFX_FAKE_PIN_COUNT) ? levels[pin] : -1;
+}
+
+bool pin_is_output(uint32_t pin) {
+	return (pin < NRFX_FAKE_PIN_COUNT) && outputs[pin];
+}
+
+void set_flash_region(const void* start, size_t size) {
+	flash_start = (const uint8_t*) start;
+	flash_size = size;
+}
+
+}
+
+nrfx_err_t nrfx_spim_init(nrfx_spim_t const* p_instance, nrfx_spim_config_t const* p_config,
+		nrfx_spim_evt_handler_t handler, void* p_context) {
+	spim_state_t& spim = spims[p_instance->drv_inst_idx];
+	spim.initialized = true;
+	spim.config = *p_config;
+	spim.handler = handler;
+	spim.context = p_context;
+	return NRFX_SUCCESS;
+}
+
+void nrfx_spim_uninit(nrfx_spim_t const* p_instance) {
+	spims[p_instance->drv_inst_idx].initialized = false;
+}
+
+nrfx_err_t nrfx_spim_xfer(nrfx_spim_t const* p_instance, nrfx_spim_xfer_desc_t const* p_xfer_desc,
+		uint32_t flags) {
+	record(p_instance, p_xfer_desc, false, 0);
+	return NRFX_SUCCESS;
+}
+
+nrfx_err_t nrfx_spim_xfer_dcx(nrfx_spim_t const* p_instance, nrfx_spim_xfer_desc_t const* p_xfer_desc,
+		uint32_t flags, uint8_t cmd_length) {
+	record(p_instance, p_xfer_desc, true, cmd_length);
+	return NRFX_SUCCESS;
+}
+
+bool nrfx_is_in_ram(void const* p_object) {
+	const uint8_t* p = (const uint8_t*) p_object;
+	return !(flash_start && p >= flash_start && p < (flash_start + flash_size));
+}
+
+extern "C" {
+	void nrfx_spim_0_irq_handler(void) { }
+	void nrfx_spim_1_irq_handler(void) { }
+	void nrfx_spim_2_irq_handler(void) { }
+	void nrfx_spim_3_irq_handler(void) { }
+}
+
+void nrf_gpio_cfg_output(uint32_t pin_number) {
+	if(pin_number < NRFX_FAKE_PIN_COUNT) {
+		outputs[pin_number] = true;
+	}
+}
+
+void nrf_gpio_pin_set(uint32_t pin_number) {
+	nrf_gpio_pin_write(pin_number, 1);
+}
+
+void nrf_gpio_pin_clear(uint32_t pin_number) {
+	nrf_gpio_pin_write(pin_number, 0);
+}
+
+void nrf_gpio_pin_write(uint32_t pin_number, uint32_t value) {
+	if(pin_number < NRFX_FAKE_PIN_COUNT) {
+		levels[pin_number] = (value ? 1 : 0);
+	}
+}
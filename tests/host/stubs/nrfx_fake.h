@@ -0,0 +1,85 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Fake nrfx SPIM driver and GPIO HAL for host tests
+ *
+ * Transfers complete synchronously: the instance's event handler is called
+ * before nrfx_spim_xfer() returns, so chained chunks are started from
+ * within the handler just like on the target.
+ */
+
+#ifndef UDISPLAY_TESTS_HOST_STUBS_NRFX_FAKE_H_
+#define UDISPLAY_TESTS_HOST_STUBS_NRFX_FAKE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <vector>
+
+#include "nrfx_spim.h"
+
+/** Number of SPIM instances */
+#define NRFX_FAKE_SPIM_COUNT	4
+
+/** Number of GPIO pins tracked */
+#define NRFX_FAKE_PIN_COUNT		32
+
+/**
+ * A recorded EasyDMA transfer
+ */
+typedef struct {
+	uint8_t instance;				/** SPIM instance the transfer was started on */
+	bool hw_dcx;					/** Started with nrfx_spim_xfer_dcx() */
+	uint32_t cmd_bytes;				/** Command bytes counted by the hardware D/C logic */
+	int dc_level;					/** Level of the watched D/C GPIO during the transfer */
+	const uint8_t* tx;				/** Buffer the transfer was started from */
+	std::vector<uint8_t> bytes;		/** Bytes that went out on the wire */
+} nrfx_fake_xfer_t;
+
+namespace nrfx_fake {
+
+/** Forgets every transfer, pin level and initialized instance */
+void reset(void);
+
+/** Transfers recorded since the last reset()/clear_xfers() */
+const std::vector<nrfx_fake_xfer_t>& xfers(void);
+
+/** Forgets the recorded transfers only */
+void clear_xfers(void);
+
+/** Checks if an instance is initialized */
+bool initialized(uint8_t instance);
+
+/** Configuration an instance was last initialized with */
+const nrfx_spim_config_t& config(uint8_t instance);
+
+/** Sets the pin whose level is recorded with every transfer (eg: the D/C GPIO) */
+void watch_pin(uint32_t pin);
+
+/** Current level of a pin, -1 if never written */
+int pin_level(uint32_t pin);
+
+/** Checks if a pin was configured as an output */
+bool pin_is_output(uint32_t pin);
+
+/** Makes nrfx_is_in_ram() return false for a region (eg: a "flash" image) */
+void set_flash_region(const void* start, size_t size);
+
+}
+
+#endif /* UDISPLAY_TESTS_HOST_STUBS_NRFX_FAKE_H_ */
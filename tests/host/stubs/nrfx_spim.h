@@ -0,0 +1,140 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Host test stand-in for the nrfx SPIM driver
+ *
+ * Only what DisplaySPIM uses. The driver is implemented by nrfx_fake.cpp,
+ * which records every transfer and completes it straight away.
+ */
+
+#ifndef UDISPLAY_TESTS_HOST_STUBS_NRFX_SPIM_H_
+#define UDISPLAY_TESTS_HOST_STUBS_NRFX_SPIM_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "PinNames.h"
+
+#define NRFX_SPIM0_ENABLED 1
+#define NRFX_SPIM1_ENABLED 1
+#define NRFX_SPIM2_ENABLED 1
+#define NRFX_SPIM3_ENABLED 1
+
+typedef uint32_t nrfx_err_t;
+
+#define NRF_SUCCESS				0
+#define NRFX_SUCCESS			0
+
+#define NRFX_SPIM_PIN_NOT_USED	0xFF
+
+typedef enum {
+	SPIM0_SPIS0_TWIM0_TWIS0_SPI0_TWI0_IRQn = 3,
+	SPIM1_SPIS1_TWIM1_TWIS1_SPI1_TWI1_IRQn = 4,
+	SPIM2_SPIS2_SPI2_IRQn = 35,
+	SPIM3_IRQn = 47
+} IRQn_Type;
+
+/** No vector table on a host, the vector argument is not even evaluated */
+#define NVIC_SetVector(irqn, vector) ((void) (irqn))
+
+typedef struct {
+	uint8_t drv_inst_idx;
+} nrfx_spim_t;
+
+#define NRFX_SPIM_INSTANCE(id) { id }
+
+typedef enum {
+	NRF_SPIM_MODE_0,
+	NRF_SPIM_MODE_1,
+	NRF_SPIM_MODE_2,
+	NRF_SPIM_MODE_3
+} nrf_spim_mode_t;
+
+typedef enum {
+	NRF_SPIM_BIT_ORDER_MSB_FIRST,
+	NRF_SPIM_BIT_ORDER_LSB_FIRST
+} nrf_spim_bit_order_t;
+
+typedef enum {
+	NRF_SPIM_FREQ_125K = 0x02000000,
+	NRF_SPIM_FREQ_250K = 0x04000000,
+	NRF_SPIM_FREQ_500K = 0x08000000,
+	NRF_SPIM_FREQ_1M = 0x10000000,
+	NRF_SPIM_FREQ_2M = 0x20000000,
+	NRF_SPIM_FREQ_4M = 0x40000000,
+	NRF_SPIM_FREQ_8M = (int) 0x80000000,
+	NRF_SPIM_FREQ_16M = 0x0A000000,
+	NRF_SPIM_FREQ_32M = 0x14000000
+} nrf_spim_frequency_t;
+
+typedef struct {
+	uint8_t sck_pin;
+	uint8_t mosi_pin;
+	uint8_t miso_pin;
+	uint8_t ss_pin;
+	bool ss_active_high;
+	uint8_t irq_priority;
+	uint8_t orc;
+	nrf_spim_frequency_t frequency;
+	nrf_spim_mode_t mode;
+	nrf_spim_bit_order_t bit_order;
+	bool use_hw_ss;
+	uint8_t ss_duration;
+	uint8_t rx_delay;
+	uint8_t dcx_pin;
+} nrfx_spim_config_t;
+
+typedef struct {
+	uint8_t const* p_tx_buffer;
+	size_t tx_length;
+	uint8_t* p_rx_buffer;
+	size_t rx_length;
+} nrfx_spim_xfer_desc_t;
+
+typedef enum {
+	NRFX_SPIM_EVENT_DONE
+} nrfx_spim_evt_type_t;
+
+typedef struct {
+	nrfx_spim_evt_type_t type;
+	nrfx_spim_xfer_desc_t xfer_desc;
+} nrfx_spim_evt_t;
+
+typedef void (*nrfx_spim_evt_handler_t)(nrfx_spim_evt_t const* p_event, void* p_context);
+
+nrfx_err_t nrfx_spim_init(nrfx_spim_t const* p_instance, nrfx_spim_config_t const* p_config,
+		nrfx_spim_evt_handler_t handler, void* p_context);
+
+void nrfx_spim_uninit(nrfx_spim_t const* p_instance);
+
+nrfx_err_t nrfx_spim_xfer(nrfx_spim_t const* p_instance, nrfx_spim_xfer_desc_t const* p_xfer_desc,
+		uint32_t flags);
+
+nrfx_err_t nrfx_spim_xfer_dcx(nrfx_spim_t const* p_instance, nrfx_spim_xfer_desc_t const* p_xfer_desc,
+		uint32_t flags, uint8_t cmd_length);
+
+bool nrfx_is_in_ram(void const* p_object);
+
+extern "C" {
+	void nrfx_spim_0_irq_handler(void);
+	void nrfx_spim_1_irq_handler(void);
+	void nrfx_spim_2_irq_handler(void);
+	void nrfx_spim_3_irq_handler(void);
+}
+
+#endif /* UDISPLAY_TESTS_HOST_STUBS_NRFX_SPIM_H_ */
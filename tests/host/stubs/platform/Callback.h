@@ -0,0 +1,72 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Host test stand-in for mbed::Callback, backed by std::function
+ */
+
+#ifndef UDISPLAY_TESTS_HOST_STUBS_CALLBACK_H_
+#define UDISPLAY_TESTS_HOST_STUBS_CALLBACK_H_
+
+#include <functional>
+
+namespace mbed {
+
+template<typename F>
+class Callback;
+
+template<typename R, typename... Args>
+class Callback<R(Args...)>
+{
+	public:
+
+		Callback(R (*fn)(Args...) = 0) {
+			if(fn) {
+				_fn = fn;
+			}
+		}
+
+		template<typename T>
+		Callback(T* obj, R (T::*method)(Args...)) :
+			_fn([obj, method](Args... args) { return (obj->*method)(args...); }) { }
+
+		R call(Args... args) const {
+			return _fn(args...);
+		}
+
+		R operator()(Args... args) const {
+			return _fn(args...);
+		}
+
+		explicit operator bool() const {
+			return (bool) _fn;
+		}
+
+	private:
+
+		std::function<R(Args...)> _fn;
+
+};
+
+template<typename T, typename R, typename... Args>
+Callback<R(Args...)> callback(T* obj, R (T::*method)(Args...)) {
+	return Callback<R(Args...)>(obj, method);
+}
+
+} // namespace mbed
+
+#endif /* UDISPLAY_TESTS_HOST_STUBS_CALLBACK_H_ */
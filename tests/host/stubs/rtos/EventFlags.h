@@ -0,0 +1,75 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Host test stand-in for rtos::EventFlags
+ *
+ * Single threaded: waiting for flags that are not set fails immediately
+ * with osFlagsError instead of blocking.
+ */
+
+#ifndef UDISPLAY_TESTS_HOST_STUBS_EVENTFLAGS_H_
+#define UDISPLAY_TESTS_HOST_STUBS_EVENTFLAGS_H_
+
+#include <stdint.h>
+
+#define osWaitForever	0xFFFFFFFFU
+#define osFlagsError	0x80000000U
+
+namespace rtos {
+
+class EventFlags
+{
+	public:
+
+		EventFlags(const char* name = NULL) : _flags(0) { }
+
+		uint32_t set(uint32_t flags) {
+			_flags |= flags;
+			return _flags;
+		}
+
+		uint32_t clear(uint32_t flags = 0x7FFFFFFF) {
+			uint32_t previous = _flags;
+			_flags &= ~flags;
+			return previous;
+		}
+
+		uint32_t get(void) const {
+			return _flags;
+		}
+
+		uint32_t wait_any(uint32_t flags, uint32_t millisec = osWaitForever, bool clear = true) {
+			uint32_t set_flags = (_flags & flags);
+			if(set_flags == 0) {
+				return osFlagsError;
+			}
+			if(clear) {
+				_flags &= ~set_flags;
+			}
+			return set_flags;
+		}
+
+	private:
+
+		uint32_t _flags;
+
+};
+
+} // namespace rtos
+
+#endif /* UDISPLAY_TESTS_HOST_STUBS_EVENTFLAGS_H_ */
@@ -0,0 +1,236 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "DisplaySPI.h"
+#include "nrfx_fake.h"
+
+#include "host_test.h"
+
+#define MOSI	P0_1
+#define SCLK	P0_2
+#define CS		P0_3
+#define DCX		P0_4
+
+static uint8_t frame[240 * 240 * 2 + 1];
+
+static void fill_frame(void) {
+	for(uint32_t i = 0; i < sizeof(frame); i++) {
+		frame[i] = (uint8_t) (i * 7);
+	}
+}
+
+/** Checks that the recorded transfers carry exactly the given bytes */
+static bool wire_matches(const uint8_t* expected, uint32_t length) {
+	uint32_t offset = 0;
+	const std::vector<nrfx_fake_xfer_t>& xfers = nrfx_fake::xfers();
+	for(size_t i = 0; i < xfers.size(); i++) {
+		const std::vector<uint8_t>& bytes = xfers[i].bytes;
+		if((offset + bytes.size()) > length ||
+				memcmp(&bytes[0], expected + offset, bytes.size()) != 0) {
+			return false;
+		}
+		offset += bytes.size();
+	}
+	return (offset == length);
+}
+
+static void test_instance_selection(void) {
+	nrfx_fake::reset();
+	{
+		DisplaySPIM<1> spim1(MOSI, SCLK, CS, DCX);
+		HOST_CHECK(nrfx_fake::initialized(1));
+		HOST_CHECK(!nrfx_fake::initialized(0));
+		HOST_CHECK(!nrfx_fake::initialized(3));
+
+		uint8_t data = 0x5A;
+		spim1.write(data, false);
+		HOST_CHECK_EQUAL(1, nrfx_fake::xfers().size());
+		HOST_CHECK_EQUAL(1, nrfx_fake::xfers()[0].instance);
+	}
+	HOST_CHECK(!nrfx_fake::initialized(1));
+
+	// The original DisplaySPI name is SPIM3
+	nrfx_fake::reset();
+	{
+		DisplaySPI spi(MOSI, SCLK, CS, DCX);
+		HOST_CHECK(nrfx_fake::initialized(3));
+	}
+}
+
+static void test_hardware_dcx(void) {
+	nrfx_fake::reset();
+	fill_frame();
+	DisplaySPIM<3> spim(MOSI, SCLK, CS, DCX);
+
+	// D/C is handed to the peripheral, not driven as a GPIO
+	HOST_CHECK_EQUAL(DCX, nrfx_fake::config(3).dcx_pin);
+	HOST_CHECK(!nrfx_fake::pin_is_output(DCX));
+
+	// Command and data go out in a single transfer
+	spim.write(frame, 1, 5);
+	const std::vector<nrfx_fake_xfer_t>& xfers = nrfx_fake::xfers();
+	HOST_CHECK_EQUAL(1, xfers.size());
+	HOST_CHECK(xfers[0].hw_dcx);
+	HOST_CHECK_EQUAL(1, xfers[0].cmd_bytes);
+	HOST_CHECK_EQUAL(5, xfers[0].bytes.size());
+	HOST_CHECK(wire_matches(frame, 5));
+}
+
+static void test_hardware_dcx_long_command(void) {
+	nrfx_fake::reset();
+	fill_frame();
+	DisplaySPIM<3> spim(MOSI, SCLK, CS, DCX);
+
+	// A DCX count of 15 would send the data as commands too
+	spim.write(frame, 20, 30);
+	const std::vector<nrfx_fake_xfer_t>& xfers = nrfx_fake::xfers();
+	HOST_CHECK_EQUAL(2, xfers.size());
+	for(size_t i = 0; i < xfers.size(); i++) {
+		HOST_CHECK(xfers[i].cmd_bytes <= DISPLAY_SPI_MAX_CMD_BYTES);
+	}
+	HOST_CHECK_EQUAL(xfers[0].bytes.size(), xfers[0].cmd_bytes);
+	HOST_CHECK_EQUAL(20, xfers[0].cmd_bytes + xfers[1].cmd_bytes);
+	HOST_CHECK(wire_matches(frame, 30));
+}
+
+static void test_gpio_dcx_fallback(void) {
+	nrfx_fake::reset();
+	fill_frame();
+	nrfx_fake::watch_pin(DCX);
+
+	DisplaySPIM<0> spim(MOSI, SCLK, CS, DCX);
+
+	// D/C is a GPIO, idle at the data level
+	HOST_CHECK_EQUAL(NRFX_SPIM_PIN_NOT_USED, nrfx_fake::config(0).dcx_pin);
+	HOST_CHECK(nrfx_fake::pin_is_output(DCX));
+	HOST_CHECK_EQUAL(1, nrfx_fake::pin_level(DCX));
+
+	// Command phase with D/C low, then data phase with D/C high
+	spim.write(frame, 2, 6);
+	const std::vector<nrfx_fake_xfer_t>& xfers = nrfx_fake::xfers();
+	HOST_CHECK_EQUAL(2, xfers.size());
+	HOST_CHECK(!xfers[0].hw_dcx);
+	HOST_CHECK_EQUAL(2, xfers[0].bytes.size());
+	HOST_CHECK_EQUAL(0, xfers[0].dc_level);
+	HOST_CHECK_EQUAL(4, xfers[1].bytes.size());
+	HOST_CHECK_EQUAL(1, xfers[1].dc_level);
+	HOST_CHECK(wire_matches(frame, 6));
+	HOST_CHECK_EQUAL(1, nrfx_fake::pin_level(DCX));
+
+	// A lone command byte has no data phase
+	nrfx_fake::clear_xfers();
+	spim.write(0x29);
+	HOST_CHECK_EQUAL(1, xfers.size());
+	HOST_CHECK_EQUAL(0, xfers[0].dc_level);
+	HOST_CHECK_EQUAL(1, nrfx_fake::pin_level(DCX));
+
+	// Data only transactions never touch D/C
+	nrfx_fake::clear_xfers();
+	spim.write(frame, 0, 3);
+	HOST_CHECK_EQUAL(1, xfers.size());
+	HOST_CHECK_EQUAL(1, xfers[0].dc_level);
+}
+
+static void test_gpio_dcx_on_every_low_instance(void) {
+	nrfx_fake::reset();
+	nrfx_fake::watch_pin(DCX);
+	{
+		DisplaySPIM<1> spim(MOSI, SCLK, CS, DCX);
+		spim.write(frame, 1, 2);
+		HOST_CHECK_EQUAL(2, nrfx_fake::xfers().size());
+		HOST_CHECK(!nrfx_fake::xfers()[0].hw_dcx);
+	}
+	nrfx_fake::clear_xfers();
+	{
+		DisplaySPIM<2> spim(MOSI, SCLK, CS, DCX);
+		spim.write(frame, 1, 2);
+		HOST_CHECK_EQUAL(2, nrfx_fake::xfers().size());
+		HOST_CHECK_EQUAL(0, nrfx_fake::xfers()[0].dc_level);
+		HOST_CHECK_EQUAL(1, nrfx_fake::xfers()[1].dc_level);
+	}
+}
+
+static void test_frequency_limits(void) {
+	nrfx_fake::reset();
+	{
+		DisplaySPIM<0> spim(MOSI, SCLK, CS, DCX, 32000000);
+		HOST_CHECK_EQUAL(8000000, spim.frequency());
+		HOST_CHECK_EQUAL(NRF_SPIM_FREQ_8M, nrfx_fake::config(0).frequency);
+	}
+	{
+		DisplaySPIM<3> spim(MOSI, SCLK, CS, DCX, 32000000);
+		HOST_CHECK_EQUAL(32000000, spim.frequency());
+	}
+	{
+		DisplaySPIM<3> spim(MOSI, SCLK, CS, DCX, 5000000);
+		HOST_CHECK_EQUAL(4000000, spim.frequency());
+	}
+}
+
+static void test_long_transfer_is_chunked(void) {
+	nrfx_fake::reset();
+	fill_frame();
+	DisplaySPIM<3> spim(MOSI, SCLK, CS, DCX);
+
+	spim.write(frame, 1, sizeof(frame));
+	const std::vector<nrfx_fake_xfer_t>& xfers = nrfx_fake::xfers();
+	HOST_CHECK_EQUAL(2, xfers.size());
+	HOST_CHECK_EQUAL(DISPLAY_SPI_MAX_XFER_LEN, xfers[0].bytes.size());
+	HOST_CHECK_EQUAL(1, xfers[0].cmd_bytes);
+	HOST_CHECK_EQUAL(sizeof(frame) - DISPLAY_SPI_MAX_XFER_LEN, xfers[1].bytes.size());
+	HOST_CHECK_EQUAL(0, xfers[1].cmd_bytes);
+	HOST_CHECK(wire_matches(frame, sizeof(frame)));
+}
+
+static void test_flash_buffer_is_bounced(void) {
+	nrfx_fake::reset();
+	fill_frame();
+	nrfx_fake::set_flash_region(frame, sizeof(frame));
+	DisplaySPIM<3> spim(MOSI, SCLK, CS, DCX);
+
+	uint32_t length = (3 * DISPLAY_SPI_BOUNCE_BUFFER_SIZE) + 7;
+	spim.write(frame, 1, length);
+	const std::vector<nrfx_fake_xfer_t>& xfers = nrfx_fake::xfers();
+	HOST_CHECK_EQUAL(4, xfers.size());
+	for(size_t i = 0; i < xfers.size(); i++) {
+		// EasyDMA only ever reads from the bounce buffers
+		HOST_CHECK(xfers[i].tx < frame || xfers[i].tx >= (frame + sizeof(frame)));
+		HOST_CHECK_EQUAL((i == 0) ? 1 : 0, xfers[i].cmd_bytes);
+	}
+	HOST_CHECK(wire_matches(frame, length));
+}
+
+static void test_zero_length_write(void) {
+	nrfx_fake::reset();
+	DisplaySPIM<0> spim(MOSI, SCLK, CS, DCX);
+	spim.write(frame, 0, 0);
+	spim.write_strided(frame, 480, 0, 10);
+	HOST_CHECK_EQUAL(0, nrfx_fake::xfers().size());
+}
+
+int main(void) {
+	HOST_RUN(test_instance_selection);
+	HOST_RUN(test_hardware_dcx);
+	HOST_RUN(test_hardware_dcx_long_command);
+	HOST_RUN(test_gpio_dcx_fallback);
+	HOST_RUN(test_gpio_dcx_on_every_low_instance);
+	HOST_RUN(test_frequency_limits);
+	HOST_RUN(test_long_transfer_is_chunked);
+	HOST_RUN(test_flash_buffer_is_bounced);
+	HOST_RUN(test_zero_length_write);
+	return host_test_failures;
+}
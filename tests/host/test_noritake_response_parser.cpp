@@ -0,0 +1,253 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "NoritakeResponseParser.h"
+
+#include <vector>
+
+#include "host_test.h"
+
+/**
+ * Records every callback of a NoritakeResponseParser
+ */
+class Recorder
+{
+	public:
+
+		Recorder(NoritakeResponseParser& parser) : io(-1) {
+			parser.attach_touch_status(mbed::callback(this, &Recorder::on_touch_status));
+			parser.attach_touch_switch(mbed::callback(this, &Recorder::on_touch_switch));
+			parser.attach_touch_levels(mbed::callback(this, &Recorder::on_touch_levels));
+			parser.attach_io_input(mbed::callback(this, &Recorder::on_io_input));
+			parser.attach_response(mbed::callback(this, &Recorder::on_response));
+		}
+
+		void on_touch_status(uint32_t switches) {
+			status.push_back(switches);
+		}
+
+		void on_touch_switch(uint8_t sw, bool on) {
+			switches.push_back(sw);
+			states.push_back(on);
+		}
+
+		void on_touch_levels(uint8_t id, const uint8_t* data, uint8_t count) {
+			levels_id = id;
+			levels.assign(data, data + count);
+		}
+
+		void on_io_input(uint8_t value) {
+			io = value;
+		}
+
+		void on_response(const uint8_t* data, uint32_t length) {
+			responses.push_back(std::vector<uint8_t>(data, data + length));
+		}
+
+		std::vector<uint32_t> status;
+
+		std::vector<uint8_t> switches;
+
+		std::vector<bool> states;
+
+		uint8_t levels_id;
+
+		std::vector<uint8_t> levels;
+
+		int io;
+
+		std::vector<std::vector<uint8_t> > responses;
+
+};
+
+static void test_touch_status_all(void) {
+	NoritakeResponseParser parser;
+	Recorder rec(parser);
+
+	// Highest switch numbers come first: SW9 in the first byte, SW8 in the last
+	const uint8_t response[] = { 0x10, 0x02, 0x01, 0x80 };
+	parser.feed(response, sizeof(response));
+	HOST_CHECK_EQUAL(1, rec.status.size());
+	HOST_CHECK_EQUAL(0x0180, rec.status[0]);
+	HOST_CHECK_EQUAL(1, rec.responses.size());
+	HOST_CHECK_EQUAL(sizeof(response), rec.responses[0].size());
+
+	// Four bytes cover 32 switches, SW1 is bit 0
+	const uint8_t all[] = { 0x10, 0x04, 0x80, 0x00, 0x00, 0x01 };
+	parser.feed(all, sizeof(all));
+	HOST_CHECK_EQUAL(2, rec.status.size());
+	HOST_CHECK_EQUAL(0x80000001UL, rec.status[1]);
+	HOST_CHECK_EQUAL(0, parser.discarded());
+}
+
+static void test_touch_status_empty(void) {
+	NoritakeResponseParser parser;
+	Recorder rec(parser);
+
+	const uint8_t response[] = { 0x10, 0x00 };
+	parser.feed(response, sizeof(response));
+	HOST_CHECK_EQUAL(1, rec.status.size());
+	HOST_CHECK_EQUAL(0, rec.status[0]);
+}
+
+static void test_touch_switch(void) {
+	NoritakeResponseParser parser;
+	Recorder rec(parser);
+
+	const uint8_t response[] = { 0x11, 0x03, 0x01, 0x11, 0x00, 0x00 };
+	parser.feed(response, sizeof(response));
+	HOST_CHECK_EQUAL(2, rec.switches.size());
+	HOST_CHECK_EQUAL(3, rec.switches[0]);
+	HOST_CHECK(rec.states[0]);
+	HOST_CHECK_EQUAL(0, rec.switches[1]);
+	HOST_CHECK(!rec.states[1]);
+	HOST_CHECK_EQUAL(2, rec.responses.size());
+}
+
+static void test_touch_levels(void) {
+	NoritakeResponseParser parser;
+	Recorder rec(parser);
+
+	// Levels are sent from the highest switch number and delivered SW1 first
+	const uint8_t count[] = { 0x14, 0x03, 0x33, 0x22, 0x11 };
+	parser.feed(count, sizeof(count));
+	HOST_CHECK_EQUAL(0x14, rec.levels_id);
+	HOST_CHECK_EQUAL(3, rec.levels.size());
+	HOST_CHECK_EQUAL(0x11, rec.levels[0]);
+	HOST_CHECK_EQUAL(0x22, rec.levels[1]);
+	HOST_CHECK_EQUAL(0x33, rec.levels[2]);
+
+	const uint8_t level[] = { 0x15, 0x02, 0x05, 0x07 };
+	parser.feed(level, sizeof(level));
+	HOST_CHECK_EQUAL(0x15, rec.levels_id);
+	HOST_CHECK_EQUAL(2, rec.levels.size());
+	HOST_CHECK_EQUAL(0x07, rec.levels[0]);
+	HOST_CHECK_EQUAL(0x05, rec.levels[1]);
+}
+
+static void test_header_responses(void) {
+	NoritakeResponseParser parser;
+	Recorder rec(parser);
+
+	// I/O port input
+	const uint8_t io[] = { 0x28, 0x70, 0x20, 0x5A };
+	parser.feed(io, sizeof(io));
+	HOST_CHECK_EQUAL(0x5A, rec.io);
+
+	// Memory SW data send and user setup mode start only reach the response handler
+	const uint8_t memory_sw[] = { 0x28, 0x65, 0x04, 0x07, 0x28, 0x65, 0x01, 0x00 };
+	parser.feed(memory_sw, sizeof(memory_sw));
+	HOST_CHECK_EQUAL(0x5A, rec.io);
+	HOST_CHECK_EQUAL(3, rec.responses.size());
+	HOST_CHECK_EQUAL(4, rec.responses[1].size());
+	HOST_CHECK_EQUAL(0x04, rec.responses[1][2]);
+	HOST_CHECK_EQUAL(0x07, rec.responses[1][3]);
+	HOST_CHECK_EQUAL(0x01, rec.responses[2][2]);
+	HOST_CHECK_EQUAL(0, parser.discarded());
+}
+
+static void test_resync_after_garbage(void) {
+	NoritakeResponseParser parser;
+	Recorder rec(parser);
+
+	const uint8_t data[] = { 0x00, 0xFF, 0x55, 0x11, 0x01, 0x01 };
+	parser.feed(data, sizeof(data));
+	HOST_CHECK_EQUAL(3, parser.discarded());
+	HOST_CHECK_EQUAL(1, rec.switches.size());
+	HOST_CHECK_EQUAL(1, rec.switches[0]);
+
+	// An unknown header group drops the header, the byte is parsed again
+	const uint8_t header[] = { 0x28, 0x71, 0x28, 0x70, 0x20, 0x01 };
+	parser.feed(header, sizeof(header));
+	HOST_CHECK_EQUAL(5, parser.discarded());
+	HOST_CHECK_EQUAL(0x01, rec.io);
+	HOST_CHECK_EQUAL(2, rec.responses.size());
+}
+
+static void test_resync_after_bad_length(void) {
+	NoritakeResponseParser parser;
+	Recorder rec(parser);
+
+	// 0x28 is above the maximum data length, it starts the next response instead
+	const uint8_t data[] = { 0x10, 0x28, 0x70, 0x20, 0x07 };
+	parser.feed(data, sizeof(data));
+	HOST_CHECK_EQUAL(1, parser.discarded());
+	HOST_CHECK_EQUAL(0, rec.status.size());
+	HOST_CHECK_EQUAL(0x07, rec.io);
+
+	const uint8_t length[] = { 0x14, NORITAKE_RESPONSE_MAX_DATA + 1, 0x11, 0x02, 0x01 };
+	parser.feed(length, sizeof(length));
+	HOST_CHECK_EQUAL(3, parser.discarded());
+	HOST_CHECK_EQUAL(0, rec.levels.size());
+	HOST_CHECK_EQUAL(1, rec.switches.size());
+	HOST_CHECK_EQUAL(2, rec.switches[0]);
+}
+
+static void test_split_feed(void) {
+	NoritakeResponseParser parser;
+	Recorder rec(parser);
+
+	const uint8_t data[] = { 0x10, 0x02, 0x40, 0x02, 0x28, 0x70, 0x20, 0x33 };
+
+	// One byte at a time
+	for(uint32_t i = 0; i < sizeof(data); i++) {
+		parser.feed(&data[i], 1);
+	}
+	HOST_CHECK_EQUAL(1, rec.status.size());
+	HOST_CHECK_EQUAL(0x4002, rec.status[0]);
+	HOST_CHECK_EQUAL(0x33, rec.io);
+
+	// Split inside the data and inside the header
+	parser.feed(data, 3);
+	HOST_CHECK_EQUAL(1, rec.status.size());
+	parser.feed(data + 3, 3);
+	HOST_CHECK_EQUAL(2, rec.status.size());
+	HOST_CHECK_EQUAL(0x4002, rec.status[1]);
+	rec.io = -1;
+	parser.feed(data + 6, 2);
+	HOST_CHECK_EQUAL(0x33, rec.io);
+	HOST_CHECK_EQUAL(4, rec.responses.size());
+	HOST_CHECK_EQUAL(0, parser.discarded());
+}
+
+static void test_reset_drops_partial(void) {
+	NoritakeResponseParser parser;
+	Recorder rec(parser);
+
+	const uint8_t partial[] = { 0x14, 0x03, 0x01 };
+	parser.feed(partial, sizeof(partial));
+	parser.reset();
+
+	const uint8_t response[] = { 0x11, 0x04, 0x01 };
+	parser.feed(response, sizeof(response));
+	HOST_CHECK_EQUAL(0, rec.levels.size());
+	HOST_CHECK_EQUAL(1, rec.switches.size());
+	HOST_CHECK_EQUAL(4, rec.switches[0]);
+}
+
+int main(void) {
+	HOST_RUN(test_touch_status_all);
+	HOST_RUN(test_touch_status_empty);
+	HOST_RUN(test_touch_switch);
+	HOST_RUN(test_touch_levels);
+	HOST_RUN(test_header_responses);
+	HOST_RUN(test_resync_after_garbage);
+	HOST_RUN(test_resync_after_bad_length);
+	HOST_RUN(test_split_feed);
+	HOST_RUN(test_reset_drops_partial);
+	return host_test_failures;
+}
@@ -0,0 +1,257 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Parallel8080.h"
+
+#include <vector>
+
+#include "host_test.h"
+
+/** Bus event types recorded by SimBus */
+enum {
+	SIM_SELECT,			/** CS asserted */
+	SIM_RELEASE,		/** CS released */
+	SIM_RS,				/** RS driven (value is the level) */
+	SIM_LATCH			/** Rising edge of WR (value is the data lines) */
+};
+
+typedef struct {
+	int type;
+	uint32_t value;
+	int cs;				/** CS level when the event happened */
+	int rs;				/** RS level when the event happened */
+} sim_event_t;
+
+/**
+ * Simulated 8080 bus recording every control line change and latched word
+ */
+template<uint32_t Width>
+class SimBus
+{
+	public:
+
+		static const uint32_t width = Width;
+
+		SimBus(void) : _data(0), _wr(1), _rs(PARALLEL8080_DATA_LOGIC_LEVEL), _cs(1),
+			_overflows(0) {
+		}
+
+		void write(uint32_t value) {
+			// Only the data lines that exist are driven
+			_data = value & ((1UL << Width) - 1);
+			if(_data != value) {
+				_overflows++;
+			}
+		}
+
+		void strobe_write(void) {
+			// The panel latches the data lines on the rising edge
+			_wr = 0;
+			_wr = 1;
+			record(SIM_LATCH, _data);
+		}
+
+		void set_rs(int level) {
+			_rs = level;
+			record(SIM_RS, level);
+		}
+
+		void select(bool selected) {
+			_cs = (selected ? 0 : 1);
+			record(selected ? SIM_SELECT : SIM_RELEASE, 0);
+		}
+
+		std::vector<sim_event_t> events;
+
+		/** Number of values written with bits above the bus width */
+		uint32_t overflows(void) const {
+			return _overflows;
+		}
+
+		/** Latched words, in order */
+		std::vector<uint32_t> latched(void) const {
+			std::vector<uint32_t> words;
+			for(size_t i = 0; i < events.size(); i++) {
+				if(events[i].type == SIM_LATCH) {
+					words.push_back(events[i].value);
+				}
+			}
+			return words;
+		}
+
+	private:
+
+		void record(int type, uint32_t value) {
+			sim_event_t evt = { type, value, _cs, _rs };
+			events.push_back(evt);
+		}
+
+		uint32_t _data;
+		int _wr;
+		int _rs;
+		int _cs;
+		uint32_t _overflows;
+
+};
+
+static void test_command_cycle_8bit(void) {
+	SimBus<8> bus;
+	Parallel8080<SimBus<8> > lcd(bus);
+
+	const uint8_t caset[] = { MIPI_DCS_SET_COLUMN_ADDRESS, 0x00, 0x10, 0x00, 0xEF };
+	lcd.write(caset, 1, sizeof(caset));
+
+	// CS, RS low, command latched, RS high, parameters latched, CS released
+	const std::vector<sim_event_t>& e = bus.events;
+	HOST_CHECK_EQUAL(9, e.size());
+	HOST_CHECK_EQUAL(SIM_SELECT, e[0].type);
+	HOST_CHECK_EQUAL(SIM_RS, e[1].type);
+	HOST_CHECK_EQUAL(PARALLEL8080_COMMAND_LOGIC_LEVEL, e[1].value);
+	HOST_CHECK_EQUAL(SIM_LATCH, e[2].type);
+	HOST_CHECK_EQUAL(MIPI_DCS_SET_COLUMN_ADDRESS, e[2].value);
+	HOST_CHECK_EQUAL(0, e[2].cs);
+	HOST_CHECK_EQUAL(PARALLEL8080_COMMAND_LOGIC_LEVEL, e[2].rs);
+	HOST_CHECK_EQUAL(SIM_RS, e[3].type);
+	HOST_CHECK_EQUAL(PARALLEL8080_DATA_LOGIC_LEVEL, e[3].value);
+	for(int i = 0; i < 4; i++) {
+		HOST_CHECK_EQUAL(SIM_LATCH, e[4 + i].type);
+		HOST_CHECK_EQUAL(caset[1 + i], e[4 + i].value);
+		HOST_CHECK_EQUAL(0, e[4 + i].cs);
+		HOST_CHECK_EQUAL(PARALLEL8080_DATA_LOGIC_LEVEL, e[4 + i].rs);
+	}
+	HOST_CHECK_EQUAL(SIM_RELEASE, e[8].type);
+	HOST_CHECK_EQUAL(0, bus.overflows());
+
+	// Byte and transaction counters are kept without UDISPLAY_STATS_TIMING
+	display_stats_t stats;
+	lcd.get_stats(stats);
+	HOST_CHECK_EQUAL(1, stats.transactions);
+	HOST_CHECK_EQUAL(1, stats.cmd_bytes);
+	HOST_CHECK_EQUAL(4, stats.data_bytes);
+	HOST_CHECK_EQUAL(0, stats.blocked_us);
+}
+
+static void test_single_command_byte(void) {
+	SimBus<8> bus;
+	Parallel8080<SimBus<8> > lcd(bus);
+
+	lcd.write(MIPI_DCS_SET_DISPLAY_ON);
+	std::vector<uint32_t> words = bus.latched();
+	HOST_CHECK_EQUAL(1, words.size());
+	HOST_CHECK_EQUAL(MIPI_DCS_SET_DISPLAY_ON, words[0]);
+
+	// RS idles at the data level between transactions
+	HOST_CHECK_EQUAL(SIM_RS, bus.events[bus.events.size() - 2].type);
+	HOST_CHECK_EQUAL(PARALLEL8080_DATA_LOGIC_LEVEL, bus.events[bus.events.size() - 2].value);
+}
+
+static void test_data_only_cycle(void) {
+	SimBus<8> bus;
+	Parallel8080<SimBus<8> > lcd(bus);
+
+	const uint8_t data[] = { 0xAA, 0x55, 0x0F };
+	lcd.write(data, 0, sizeof(data));
+
+	// RS is never driven to command
+	const std::vector<sim_event_t>& e = bus.events;
+	HOST_CHECK_EQUAL(5, e.size());
+	HOST_CHECK_EQUAL(SIM_SELECT, e[0].type);
+	for(int i = 0; i < 3; i++) {
+		HOST_CHECK_EQUAL(SIM_LATCH, e[1 + i].type);
+		HOST_CHECK_EQUAL(data[i], e[1 + i].value);
+		HOST_CHECK_EQUAL(PARALLEL8080_DATA_LOGIC_LEVEL, e[1 + i].rs);
+	}
+	HOST_CHECK_EQUAL(SIM_RELEASE, e[4].type);
+}
+
+static void test_pixel_packing_16bit(void) {
+	SimBus<16> bus;
+	Parallel8080<SimBus<16> > lcd(bus);
+
+	// Command parameters use the low data lines, one byte per strobe
+	const uint8_t raset[] = { MIPI_DCS_SET_PAGE_ADDRESS, 0x00, 0x00, 0x01, 0x3F };
+	lcd.write(raset, 1, sizeof(raset));
+	std::vector<uint32_t> words = bus.latched();
+	HOST_CHECK_EQUAL(5, words.size());
+	HOST_CHECK_EQUAL(0x013F, (words[3] << 8) | words[4]);
+
+	// Pixels after RAMWR go two bytes per strobe, first byte on the high lines
+	bus.events.clear();
+	const uint8_t ramwr[] = { MIPI_DCS_WRITE_MEMORY_START, 0xF8, 0x00, 0x07, 0xE0, 0x1F };
+	lcd.write(ramwr, 1, sizeof(ramwr));
+	words = bus.latched();
+	HOST_CHECK_EQUAL(3, words.size());
+	HOST_CHECK_EQUAL(MIPI_DCS_WRITE_MEMORY_START, words[0]);
+	HOST_CHECK_EQUAL(0xF800, words[1]);
+	HOST_CHECK_EQUAL(0x07E0, words[2]);
+
+	// Data-only continuations of a memory write stay packed, and a pixel
+	// split across two writes is latched whole
+	bus.events.clear();
+	const uint8_t more[] = { 0x12, 0x34 };
+	lcd.write(more, 0, sizeof(more));
+	words = bus.latched();
+	HOST_CHECK_EQUAL(1, words.size());
+	HOST_CHECK_EQUAL(0x1F12, words[0]);
+
+	bus.events.clear();
+	lcd.write(0x56, false);
+	words = bus.latched();
+	HOST_CHECK_EQUAL(1, words.size());
+	HOST_CHECK_EQUAL(0x3456, words[0]);
+
+	bus.events.clear();
+	lcd.write(0x78, false);
+	HOST_CHECK_EQUAL(0, bus.latched().size());
+
+	// Until another command is sent, a lone trailing byte goes out first
+	bus.events.clear();
+	const uint8_t madctl[] = { MIPI_DCS_SET_ADDRESS_MODE, 0x60 };
+	lcd.write(madctl, 1, sizeof(madctl));
+	const std::vector<sim_event_t>& e = bus.events;
+	words = bus.latched();
+	HOST_CHECK_EQUAL(3, words.size());
+	HOST_CHECK_EQUAL(0x7800, words[0]);
+	HOST_CHECK_EQUAL(SIM_LATCH, e[1].type);
+	HOST_CHECK_EQUAL(PARALLEL8080_DATA_LOGIC_LEVEL, e[1].rs);
+	HOST_CHECK_EQUAL(MIPI_DCS_SET_ADDRESS_MODE, words[1]);
+	HOST_CHECK_EQUAL(0x60, words[2]);
+
+	HOST_CHECK_EQUAL(0, bus.overflows());
+}
+
+static void test_8bit_bus_never_packs(void) {
+	SimBus<8> bus;
+	Parallel8080<SimBus<8> > lcd(bus);
+
+	const uint8_t ramwr[] = { MIPI_DCS_WRITE_MEMORY_START, 0xF8, 0x00, 0x07 };
+	lcd.write(ramwr, 1, sizeof(ramwr));
+	std::vector<uint32_t> words = bus.latched();
+	HOST_CHECK_EQUAL(4, words.size());
+	HOST_CHECK_EQUAL(0xF8, words[1]);
+	HOST_CHECK_EQUAL(0x07, words[3]);
+	HOST_CHECK_EQUAL(0, bus.overflows());
+}
+
+int main(void) {
+	HOST_RUN(test_command_cycle_8bit);
+	HOST_RUN(test_single_command_byte);
+	HOST_RUN(test_data_only_cycle);
+	HOST_RUN(test_pixel_packing_16bit);
+	HOST_RUN(test_8bit_bus_never_packs);
+	return host_test_failures;
+}
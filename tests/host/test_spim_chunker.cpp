@@ -0,0 +1,168 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SPIMChunker.h"
+
+#include "host_test.h"
+
+static uint8_t frame[2 * DISPLAY_SPI_MAX_XFER_LEN + 1000];
+
+static void test_split_at_max_length(void) {
+	SPIMChunker chunker;
+	const uint8_t* chunk;
+	uint32_t len, cmd_bytes;
+
+	// One command byte, then data spilling into a third chunk
+	uint32_t length = (2 * DISPLAY_SPI_MAX_XFER_LEN) + 10;
+	chunker.start(frame, 1, length);
+
+	HOST_CHECK(chunker.next(chunk, len, cmd_bytes));
+	HOST_CHECK(chunk == frame);
+	HOST_CHECK_EQUAL(65532, len);
+	HOST_CHECK_EQUAL(1, cmd_bytes);
+
+	HOST_CHECK(chunker.next(chunk, len, cmd_bytes));
+	HOST_CHECK(chunk == frame + 65532);
+	HOST_CHECK_EQUAL(65532, len);
+	HOST_CHECK_EQUAL(0, cmd_bytes);
+
+	HOST_CHECK(chunker.next(chunk, len, cmd_bytes));
+	HOST_CHECK(chunk == frame + (2 * 65532));
+	HOST_CHECK_EQUAL(10, len);
+	HOST_CHECK_EQUAL(0, cmd_bytes);
+
+	HOST_CHECK(!chunker.next(chunk, len, cmd_bytes));
+	HOST_CHECK(chunker.done());
+}
+
+static void test_exact_max_length(void) {
+	SPIMChunker chunker;
+	const uint8_t* chunk;
+	uint32_t len, cmd_bytes;
+
+	chunker.start(frame, 0, DISPLAY_SPI_MAX_XFER_LEN);
+	HOST_CHECK(chunker.next(chunk, len, cmd_bytes));
+	HOST_CHECK_EQUAL(DISPLAY_SPI_MAX_XFER_LEN, len);
+	HOST_CHECK(!chunker.next(chunk, len, cmd_bytes));
+}
+
+static void test_zero_length(void) {
+	SPIMChunker chunker;
+	const uint8_t* chunk;
+	uint32_t len, cmd_bytes;
+
+	chunker.start(frame, 0, 0);
+	HOST_CHECK(chunker.done());
+	HOST_CHECK(!chunker.next(chunk, len, cmd_bytes));
+
+	chunker.start_strided(frame, 480, 0, 10);
+	HOST_CHECK(chunker.done());
+	HOST_CHECK(!chunker.next(chunk, len, cmd_bytes));
+
+	chunker.start_strided(frame, 480, 20, 0);
+	HOST_CHECK(!chunker.next(chunk, len, cmd_bytes));
+}
+
+static void test_odd_lengths(void) {
+	SPIMChunker chunker;
+	const uint8_t* chunk;
+	uint32_t len, cmd_bytes;
+
+	// A single byte
+	chunker.start(frame, 1, 1);
+	HOST_CHECK(chunker.next(chunk, len, cmd_bytes));
+	HOST_CHECK_EQUAL(1, len);
+	HOST_CHECK_EQUAL(1, cmd_bytes);
+	HOST_CHECK(!chunker.next(chunk, len, cmd_bytes));
+
+	// One byte over the limit
+	chunker.start(frame, 0, DISPLAY_SPI_MAX_XFER_LEN + 1);
+	HOST_CHECK(chunker.next(chunk, len, cmd_bytes));
+	HOST_CHECK_EQUAL(DISPLAY_SPI_MAX_XFER_LEN, len);
+	HOST_CHECK(chunker.next(chunk, len, cmd_bytes));
+	HOST_CHECK(chunk == frame + DISPLAY_SPI_MAX_XFER_LEN);
+	HOST_CHECK_EQUAL(1, len);
+	HOST_CHECK(!chunker.next(chunk, len, cmd_bytes));
+
+	// Odd length with a smaller per-transaction chunk (eg: bounce buffers)
+	chunker.start(frame, 3, 1001, 512);
+	HOST_CHECK(chunker.next(chunk, len, cmd_bytes));
+	HOST_CHECK_EQUAL(512, len);
+	HOST_CHECK_EQUAL(3, cmd_bytes);
+	HOST_CHECK(chunker.next(chunk, len, cmd_bytes));
+	HOST_CHECK_EQUAL(489, len);
+	HOST_CHECK_EQUAL(0, cmd_bytes);
+	HOST_CHECK(!chunker.next(chunk, len, cmd_bytes));
+}
+
+static void test_strided_rows(void) {
+	SPIMChunker chunker(16);
+	const uint8_t* chunk;
+	uint32_t len, cmd_bytes;
+
+	// Rows are never merged, and rows longer than a chunk are split
+	chunker.start_strided(frame + 10, 480, 20, 3);
+	for(uint32_t row = 0; row < 3; row++) {
+		HOST_CHECK(chunker.next(chunk, len, cmd_bytes));
+		HOST_CHECK(chunk == frame + 10 + (row * 480));
+		HOST_CHECK_EQUAL(16, len);
+		HOST_CHECK_EQUAL(0, cmd_bytes);
+		HOST_CHECK(chunker.next(chunk, len, cmd_bytes));
+		HOST_CHECK(chunk == frame + 10 + (row * 480) + 16);
+		HOST_CHECK_EQUAL(4, len);
+	}
+	HOST_CHECK(!chunker.next(chunk, len, cmd_bytes));
+}
+
+static void test_long_command_phase(void) {
+	SPIMChunker chunker;
+	const uint8_t* chunk;
+	uint32_t len, cmd_bytes;
+
+	// 0xF in DCXCNT means all command bytes, so at most 14 precede data
+	chunker.start(frame, 20, 30);
+	HOST_CHECK(chunker.next(chunk, len, cmd_bytes));
+	HOST_CHECK(chunk == frame);
+	HOST_CHECK_EQUAL(DISPLAY_SPI_MAX_CMD_BYTES, len);
+	HOST_CHECK_EQUAL(DISPLAY_SPI_MAX_CMD_BYTES, cmd_bytes);
+
+	HOST_CHECK(chunker.next(chunk, len, cmd_bytes));
+	HOST_CHECK(chunk == frame + DISPLAY_SPI_MAX_CMD_BYTES);
+	HOST_CHECK_EQUAL(30 - DISPLAY_SPI_MAX_CMD_BYTES, len);
+	HOST_CHECK_EQUAL(20 - DISPLAY_SPI_MAX_CMD_BYTES, cmd_bytes);
+	HOST_CHECK(!chunker.next(chunk, len, cmd_bytes));
+
+	// Command bytes never exceed a (bounce buffer sized) chunk
+	chunker.start(frame, 10, 20, 4);
+	uint32_t total_cmd = 0;
+	while(chunker.next(chunk, len, cmd_bytes)) {
+		HOST_CHECK(cmd_bytes <= len);
+		HOST_CHECK(len <= 4);
+		total_cmd += cmd_bytes;
+	}
+	HOST_CHECK_EQUAL(10, total_cmd);
+}
+
+int main(void) {
+	HOST_RUN(test_split_at_max_length);
+	HOST_RUN(test_exact_max_length);
+	HOST_RUN(test_zero_length);
+	HOST_RUN(test_odd_lengths);
+	HOST_RUN(test_strided_rows);
+	HOST_RUN(test_long_command_phase);
+	return host_test_failures;
+}
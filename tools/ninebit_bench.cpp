@@ -0,0 +1,170 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Host-side check and benchmark of NineBitPacker
+ *
+ * Packs random streams (split into random command/data pieces) with
+ * NineBitPacker and with a bit-by-bit reference packer and compares the
+ * output, then reports the packing throughput of both in MB/s of input.
+ *
+ * build: g++ -O2 -I. -Iplatform -o ninebit_bench tools/ninebit_bench.cpp platform/NineBitPacker.cpp
+ * usage: ninebit_bench [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "NineBitPacker.h"
+
+/** Largest stream used by the comparison */
+#define CHECK_MAX_WORDS		256
+
+/** Number of random streams compared */
+#define CHECK_STREAMS		10000
+
+/** Number of words packed per benchmark iteration */
+#define BENCH_WORDS			65536
+
+/** Packed size of a number of words, as a constant expression */
+#define PACKED_SIZE(words)	((((words) * 9) + 7) / 8)
+
+/**
+ * Reference packer, one bit at a time
+ * @param[in] in Bytes to pack
+ * @param[in] dc D/C bit of each byte
+ * @param[in] count Number of words
+ * @param[out] out Packed bytes, the last one zero padded
+ * @retval number of bytes written
+ */
+static uint32_t reference_pack(const uint8_t* in, const uint8_t* dc, uint32_t count, uint8_t* out) {
+	uint32_t length = NineBitPacker::max_packed_size(count);
+	memset(out, 0, length);
+	uint32_t bit = 0;
+	for(uint32_t i = 0; i < count; i++) {
+		uint32_t word = ((uint32_t) dc[i] << 8) | in[i];
+		for(int k = 8; k >= 0; k--, bit++) {
+			if((word >> k) & 1) {
+				out[bit / 8] |= (uint8_t) (0x80 >> (bit % 8));
+			}
+		}
+	}
+	return length;
+}
+
+static double now_s(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+/**
+ * Compares NineBitPacker with the reference on random streams
+ * @retval number of mismatching streams
+ */
+static uint32_t check(void) {
+	static uint8_t in[CHECK_MAX_WORDS], dc[CHECK_MAX_WORDS];
+	static uint8_t expected[PACKED_SIZE(CHECK_MAX_WORDS)];
+	static uint8_t actual[PACKED_SIZE(CHECK_MAX_WORDS)];
+	uint32_t failures = 0;
+
+	srand(1);
+	for(uint32_t stream = 0; stream < CHECK_STREAMS; stream++) {
+		// Commands first, then data, like a display transaction
+		uint32_t count = rand() % (CHECK_MAX_WORDS + 1);
+		uint32_t num_cmd = rand() % (count + 1);
+		for(uint32_t i = 0; i < count; i++) {
+			in[i] = (uint8_t) rand();
+			dc[i] = (i >= num_cmd);
+		}
+		uint32_t expected_len = reference_pack(in, dc, count, expected);
+
+		// Pack in random pieces so unaligned and aligned paths are both used
+		NineBitPacker packer;
+		uint32_t actual_len = 0;
+		uint32_t i = 0;
+		while(i < count) {
+			uint32_t end = (i < num_cmd) ? num_cmd : count;
+			uint32_t len = 1 + (rand() % (end - i));
+			actual_len += packer.pack(&in[i], len, (dc[i] != 0), &actual[actual_len]);
+			i += len;
+		}
+		actual_len += packer.flush(&actual[actual_len]);
+
+		if(actual_len != expected_len || memcmp(expected, actual, expected_len) != 0) {
+			if(failures == 0) {
+				fprintf(stderr, "mismatch: stream %u, %u words (%u commands)\n",
+						(unsigned) stream, (unsigned) count, (unsigned) num_cmd);
+			}
+			failures++;
+		}
+	}
+	return failures;
+}
+
+int main(int argc, char** argv) {
+	uint32_t iterations = (argc > 1) ? (uint32_t) atoi(argv[1]) : 2000;
+	if(iterations == 0) {
+		fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+		return 2;
+	}
+
+	uint32_t failures = check();
+	printf("check: %u random streams, %u mismatches\n", (unsigned) CHECK_STREAMS,
+			(unsigned) failures);
+	if(failures) {
+		return 1;
+	}
+
+	static uint8_t in[BENCH_WORDS], dc[BENCH_WORDS];
+	static uint8_t out[PACKED_SIZE(BENCH_WORDS)];
+	for(uint32_t i = 0; i < BENCH_WORDS; i++) {
+		in[i] = (uint8_t) (i * 7);
+		dc[i] = 1;
+	}
+
+	// The checksum keeps the compiler from dropping the packing
+	uint32_t checksum = 0;
+	NineBitPacker packer;
+	double start = now_s();
+	for(uint32_t r = 0; r < iterations; r++) {
+		packer.reset();
+		uint32_t len = packer.pack(in, BENCH_WORDS, true, out);
+		len += packer.flush(&out[len]);
+		checksum += out[r % len];
+	}
+	double kernel_s = now_s() - start;
+
+	// The reference is much slower, time fewer iterations
+	uint32_t ref_iterations = (iterations / 16) ? (iterations / 16) : 1;
+	start = now_s();
+	for(uint32_t r = 0; r < ref_iterations; r++) {
+		uint32_t len = reference_pack(in, dc, BENCH_WORDS, out);
+		checksum += out[r % len];
+	}
+	double reference_s = now_s() - start;
+
+	double kernel_mbps = ((double) iterations * BENCH_WORDS) / kernel_s / 1e6;
+	double reference_mbps = ((double) ref_iterations * BENCH_WORDS) / reference_s / 1e6;
+	printf("NineBitPacker: %.1f MB/s\n", kernel_mbps);
+	printf("reference:     %.1f MB/s\n", reference_mbps);
+	printf("speedup:       %.1fx (checksum %u)\n", kernel_mbps / reference_mbps,
+			(unsigned) checksum);
+	return 0;
+}
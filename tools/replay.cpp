@@ -0,0 +1,141 @@
+/* uDisplay library
+ * Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Host-side replay of a RecordingInterface capture
+ *
+ * Feeds the recording through StreamReplayer into a DisplayInterface that
+ * prints one line per transaction (first command byte, command and data
+ * lengths, first data bytes).
+ *
+ * build: g++ -I. -Iplatform -o replay tools/replay.cpp platform/StreamReplayer.cpp
+ * usage: replay [--paced] recording.udr
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "StreamReplayer.h"
+
+/** Number of data bytes printed for each transaction */
+#define REPLAY_PREVIEW_BYTES	8
+
+class PrintInterface : public DisplayInterface
+{
+	public:
+
+		PrintInterface(FILE* out) : _out(out), _transactions(0), _bytes(0) { }
+
+		virtual void write(uint8_t data, bool is_cmd = true) {
+			this->write(&data, (is_cmd ? 1 : 0), 1);
+		}
+
+		virtual void write(const uint8_t* buffer, uint32_t num_cmd_bytes, uint32_t buf_len) {
+			if(num_cmd_bytes) {
+				fprintf(_out, "cmd 0x%02X", buffer[0]);
+			} else {
+				fprintf(_out, "data    ");
+			}
+			fprintf(_out, " cmd_bytes=%u length=%u", (unsigned) num_cmd_bytes, (unsigned) buf_len);
+
+			uint32_t data_len = buf_len - num_cmd_bytes;
+			uint32_t preview = (data_len < REPLAY_PREVIEW_BYTES) ? data_len : REPLAY_PREVIEW_BYTES;
+			if(preview) {
+				fprintf(_out, " :");
+				for(uint32_t i = 0; i < preview; i++) {
+					fprintf(_out, " %02X", buffer[num_cmd_bytes + i]);
+				}
+				if(preview < data_len) {
+					fprintf(_out, " ...");
+				}
+			}
+			fprintf(_out, "\n");
+
+			_transactions++;
+			_bytes += buf_len;
+		}
+
+		virtual uint8_t read(uint8_t* buffer, uint32_t size) { return 0; }
+
+		uint32_t transactions(void) const { return _transactions; }
+
+		uint64_t bytes(void) const { return _bytes; }
+
+	private:
+
+		FILE* _out;
+
+		uint32_t _transactions;
+
+		uint64_t _bytes;
+
+};
+
+static uint32_t host_clock(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t) ((uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+}
+
+static void host_delay(uint32_t us) {
+	struct timespec ts;
+	ts.tv_sec = us / 1000000;
+	ts.tv_nsec = (us % 1000000) * 1000;
+	nanosleep(&ts, NULL);
+}
+
+int main(int argc, char** argv) {
+	bool paced = false;
+	const char* path = NULL;
+	for(int i = 1; i < argc; i++) {
+		if(strcmp(argv[i], "--paced") == 0) {
+			paced = true;
+		} else {
+			path = argv[i];
+		}
+	}
+	if(path == NULL) {
+		fprintf(stderr, "usage: %s [--paced] recording.udr\n", argv[0]);
+		return 2;
+	}
+
+	FILE* stream = fopen(path, "rb");
+	if(stream == NULL) {
+		perror(path);
+		return 1;
+	}
+
+	static uint8_t scratch[4096];
+	PrintInterface target(stdout);
+	StreamReplayer replayer(stream, scratch, sizeof(scratch));
+	if(paced) {
+		replayer.set_pacing(host_clock, host_delay);
+	}
+
+	int32_t result = replayer.replay(target);
+	fclose(stream);
+	if(result < 0) {
+		fprintf(stderr, "%s: replay failed (%d) after %u transactions\n", path,
+				(int) result, (unsigned) target.transactions());
+		return 1;
+	}
+
+	fprintf(stderr, "%d records, %u transactions, %llu bytes\n", (int) result,
+			(unsigned) target.transactions(), (unsigned long long) target.bytes());
+	return 0;
+}
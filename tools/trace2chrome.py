@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+# uDisplay library
+# Copyright (c) 2018-2019 George "AGlass0fMilk" Beckstein
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""
+Converts a DisplayTrace::dump() capture into Chrome trace-event JSON
+
+The input may be a raw serial console log, only lines starting with "udt,"
+are used. Open the output in chrome://tracing or https://ui.perfetto.dev
+
+usage: trace2chrome.py [-o trace.json] [capture.txt]
+"""
+
+import argparse
+import json
+import sys
+
+# Must match DISPLAY_TRACE_FLAG_HAS_COMMAND in platform/DisplayTrace.h
+FLAG_HAS_COMMAND = 0x01
+
+TIMESTAMP_WRAP = 1 << 32
+
+
+def parse_records(lines):
+    """ Yields a dict for each "udt," record line """
+    for line in lines:
+        line = line.strip()
+        if not line.startswith("udt,"):
+            continue
+        fields = line.split(",")
+        if len(fields) != 9:
+            continue
+        try:
+            yield {
+                "sequence": int(fields[1]),
+                "timestamp": int(fields[2]),
+                "duration": int(fields[3]),
+                "source": int(fields[4], 16),
+                "flags": int(fields[5], 16),
+                "command": int(fields[6], 16),
+                "cmd_bytes": int(fields[7]),
+                "length": int(fields[8]),
+            }
+        except ValueError:
+            continue
+
+
+def to_chrome_events(records):
+    """ Converts trace records into a list of Chrome trace events """
+    events = []
+    sources = {}
+    last_raw = None
+    offset = 0
+
+    # The device timestamps are 32-bit microseconds, unwrap them in sequence order
+    for record in sorted(records, key=lambda r: r["sequence"]):
+        raw = record["timestamp"]
+        if last_raw is not None and raw < last_raw and (last_raw - raw) > (TIMESTAMP_WRAP // 2):
+            offset += TIMESTAMP_WRAP
+        last_raw = raw
+
+        tid = sources.setdefault(record["source"], len(sources) + 1)
+
+        if record["flags"] & FLAG_HAS_COMMAND:
+            name = "cmd 0x%02X" % record["command"]
+        else:
+            name = "data"
+
+        events.append({
+            "name": name,
+            "cat": "display",
+            "ph": "X",
+            "ts": raw + offset,
+            "dur": record["duration"],
+            "pid": 1,
+            "tid": tid,
+            "args": {
+                "sequence": record["sequence"],
+                "cmd_bytes": record["cmd_bytes"],
+                "data_bytes": record["length"] - record["cmd_bytes"],
+                "length": record["length"],
+            },
+        })
+
+    for source, tid in sources.items():
+        events.append({
+            "name": "thread_name",
+            "ph": "M",
+            "pid": 1,
+            "tid": tid,
+            "args": {"name": "interface 0x%08x" % source},
+        })
+
+    return events
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("capture", nargs="?", help="trace dump (defaults to stdin)")
+    parser.add_argument("-o", "--output", help="output JSON file (defaults to stdout)")
+    args = parser.parse_args()
+
+    if args.capture:
+        with open(args.capture, "r", errors="replace") as f:
+            records = list(parse_records(f))
+    else:
+        records = list(parse_records(sys.stdin))
+
+    trace = {"traceEvents": to_chrome_events(records), "displayTimeUnit": "ms"}
+
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(trace, f, indent=1)
+    else:
+        json.dump(trace, sys.stdout, indent=1)
+        sys.stdout.write("\n")
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())